@@ -0,0 +1,150 @@
+#include "audio.h"
+#include "music.h"
+#include "globals.h"
+
+/**
+ * DAC value of silence, the middle of its range, and the amplitude of a
+ * voice per step of volume.
+ */
+#define SILENCE 32768
+#define AMPLITUDE 32
+
+/**
+ * The voices. A voice is free while tone is NULL. audio_play fills in the
+ * rest of a free voice before setting tone, and from then on only the
+ * interrupt touches it, until it sets tone back to NULL.
+ */
+static struct {
+    const Tone* volatile tone;  // Tone playing
+    unsigned int phase;         // Position in the wave; the top bit is the square
+    unsigned int step;          // Phase advance per sample, 0 for a pause
+    unsigned int left;          // Samples left of the tone
+    int amplitude;
+} voices[AUDIO_VOICES];
+
+static Ticker ticker;
+static volatile int running;    // Whether the ticker is attached
+
+static unsigned short* volatile capture_buffer;
+static volatile int capture_size;
+static volatile int capture_count;
+
+/**
+ * Set up voice v to play tone.
+ */
+static void start_tone(int v, const Tone* tone)
+{
+    voices[v].step = (unsigned int) (((unsigned long long) tone->hz << 32) / AUDIO_RATE);
+    voices[v].left = (unsigned int) tone->ms * AUDIO_RATE / 1000;
+}
+
+/**
+ * The ticker interrupt: mix one sample and write it to the DAC.
+ */
+static void audio_tick()
+{
+    int sum = 0, playing = 0;
+    for (int v = 0; v < AUDIO_VOICES; v++) {
+        if (!voices[v].tone) continue;
+
+        // Move on to the next tone once this one is over
+        while (!voices[v].left) {
+            const Tone* next = voices[v].tone + 1;
+            if (!next->ms) {
+                voices[v].tone = NULL;
+                break;
+            }
+            voices[v].tone = next;
+            start_tone(v, next);
+        }
+        if (!voices[v].tone) continue;
+
+        playing++;
+        voices[v].left--;
+        if (voices[v].step) {
+            sum += (voices[v].phase & 0x80000000u) ? voices[v].amplitude : -voices[v].amplitude;
+            voices[v].phase += voices[v].step;
+        }
+    }
+    if (music_playing()) {
+        playing++;
+        sum += music_sample() * AMPLITUDE;
+    }
+
+    // The music on top of every voice can overflow the DAC's range
+    if (sum > SILENCE - 1) sum = SILENCE - 1;
+    if (sum < -SILENCE) sum = -SILENCE;
+    unsigned short sample = SILENCE + sum;
+    DACout.write_u16(sample);
+    if (capture_buffer && capture_count < capture_size) {
+        capture_buffer[capture_count] = sample;
+        capture_count = capture_count + 1;
+    }
+
+    // Sleep once everything is over; audio_play starts the ticker again
+    if (!playing) {
+        ticker.detach();
+        running = 0;
+    }
+}
+
+void audio_init()
+{
+    DACout.write_u16(SILENCE);
+}
+
+int audio_play(const Tone* tones, int volume)
+{
+    if (!tones->ms) return -1;
+
+    int v = 0;
+    while (v < AUDIO_VOICES && voices[v].tone) v++;
+    if (v == AUDIO_VOICES) return -1;
+
+    if (volume < 0) volume = 0;
+    if (volume > AUDIO_MAX_VOLUME) volume = AUDIO_MAX_VOLUME;
+    voices[v].amplitude = volume * AMPLITUDE;
+    voices[v].phase = 0;
+    start_tone(v, tones);
+    voices[v].tone = tones;
+
+    audio_wake();
+    return v;
+}
+
+void audio_wake()
+{
+    if (!running) {
+        running = 1;
+        ticker.attach_us(audio_tick, 1000000 / AUDIO_RATE);
+    }
+}
+
+void audio_stop()
+{
+    for (int v = 0; v < AUDIO_VOICES; v++) {
+        voices[v].tone = NULL;
+    }
+}
+
+int audio_playing()
+{
+    int playing = 0;
+    for (int v = 0; v < AUDIO_VOICES; v++) {
+        if (voices[v].tone) playing++;
+    }
+    return playing;
+}
+
+void audio_capture(unsigned short* buffer, int n)
+{
+    capture_buffer = NULL;
+    capture_count = 0;
+    capture_size = n;
+    capture_buffer = buffer;
+}
+
+int audio_captured()
+{
+    return capture_count;
+}
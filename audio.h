@@ -0,0 +1,76 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+/**
+ * Sound. A ticker interrupt mixes up to AUDIO_VOICES square-wave voices and
+ * writes the result to the speaker DAC (DACout) AUDIO_RATE times a second,
+ * so playing a sound is fire-and-forget: audio_play only hands the tones to a
+ * free voice and returns. Background music (see music.h) is mixed in too. The
+ * ticker stops while nothing plays.
+ */
+
+/**
+ * Samples per second written to the DAC.
+ */
+#define AUDIO_RATE 8000
+
+/**
+ * Sounds that can play at once. A sound started while all voices are busy is
+ * dropped.
+ */
+#define AUDIO_VOICES 4
+
+/**
+ * Loudest volume for a voice. Voices add up; AUDIO_VOICES of them at full
+ * volume just fit the DAC's range, and louder mixes (with music) are clipped.
+ */
+#define AUDIO_MAX_VOLUME 255
+
+/**
+ * One note of a sound: a square wave of hz (0 for a pause) lasting ms. A
+ * sound is an array of tones ending with one whose ms is 0.
+ */
+typedef struct {
+    unsigned short hz;
+    unsigned short ms;
+} Tone;
+
+/**
+ * Set the DAC to silence. Call once before playing anything.
+ */
+void audio_init();
+
+/**
+ * Play the tones in order on a free voice at volume (0 to
+ * AUDIO_MAX_VOLUME). The array is not copied and must stay valid while it
+ * plays, as static arrays do. Returns the voice, or -1 if none was free.
+ */
+int audio_play(const Tone* tones, int volume);
+
+/**
+ * Start the ticker if it stopped, for music that starts playing.
+ */
+void audio_wake();
+
+/**
+ * Stop every voice.
+ */
+void audio_stop();
+
+/**
+ * Returns the number of voices playing.
+ */
+int audio_playing();
+
+/**
+ * Also copy the samples written to the DAC into buffer, until n have been
+ * written, e.g. to check the output on a host. Pass NULL to stop.
+ */
+void audio_capture(unsigned short* buffer, int n);
+
+/**
+ * Returns the number of samples captured so far.
+ */
+int audio_captured();
+
+#endif // AUDIO_H
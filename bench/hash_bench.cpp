@@ -0,0 +1,339 @@
+/*
+ * hash_bench: micro-benchmarks for hash_table.cpp.
+ *
+ * Measures insertItem, getItem, removeItem and destroyHashTable for both
+ * backends across table sizes, load factors, hit/miss ratios and key
+ * distributions, and prints the chain length histogram of every table it
+ * builds (see getHashTableStats). This is a host tool; build and run it with
+ *
+ *      make -C bench run
+ *
+ * Options:
+ *
+ *      -q          quick run (small tables only)
+ *      -k packed   only run one key distribution (see below)
+ *      -H identity hash function for the chained tables: mix (mix_hash, what
+ *                  the map uses) or identity
+ *
+ * Latencies are per operation in nanoseconds, timed one operation at a time
+ * with the cost of reading the clock subtracted, so they are only meaningful
+ * relative to each other on the same machine. Mops/s is throughput: the same
+ * operations run again back to back, with the clock read only around the
+ * whole batch.
+ */
+#include "hash_table.h"
+#include "spatial_key.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Key distributions. The last three are map keys (spatial_key.h) for a square
+ * of tiles centered on (0,0), so half the coordinates are negative.
+ *   seq     0, 1, 2, ...
+ *   random  distinct keys spread over all 32 bits
+ *   cantor  cantor_key (collides for negative coordinates, so some keys of
+ *           the miss range are inserted keys after all; see miss_key)
+ *   packed  packed_key
+ *   morton  morton_key
+ */
+#define KEYS_SEQ    0
+#define KEYS_RANDOM 1
+#define NUM_DISTS   5
+static const char* key_names[NUM_DISTS] = { "seq", "random", "cantor", "packed", "morton" };
+static const CoordKeyFunc coord_keys[NUM_DISTS] = { NULL, NULL, cantor_key, packed_key, morton_key };
+
+/** Hash function for the chained tables (-H) */
+static HashFunction bench_hash = mix_hash;
+
+/**
+ * Load factors for the chained backend, in items per bucket percent. 0 means
+ * the table starts with 50 buckets and grows on its own, like the map does.
+ */
+static const unsigned int loads[] = { 50, 100, 200, 400, 0 };
+#define NUM_LOADS (sizeof(loads) / sizeof(loads[0]))
+
+#define MAP_BUCKETS 50     // NUM_BUCKETS in globals.h
+#define MIN_LOOKUPS 20000  // Lookups timed per hit ratio, at least
+
+/** A bijection on 32-bit integers, so distinct inputs give distinct keys */
+static unsigned int scramble(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * Key number i of a distribution with n keys. Keys i >= n are never inserted,
+ * which gives the misses (see miss_key).
+ */
+static unsigned int make_key(int dist, unsigned int i, unsigned int n) {
+    switch (dist) {
+        case KEYS_SEQ:
+            return i;
+        case KEYS_RANDOM:
+            return scramble(i);
+        default: {
+            int side = 1;
+            while ((unsigned int)(side * side) < n) side++;
+            // Misses come from the square just right of the inserted one
+            int x = i % side + (i / (side * side)) * side - side / 2;
+            int y = (i / side) % side - side / 2;
+            return coord_keys[dist](x, y);
+        }
+    }
+}
+
+static unsigned long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/** Cost of one clock read, subtracted from every sample */
+static unsigned long long clock_cost;
+
+static void measure_clock_cost() {
+    unsigned long long best = ~0ull;
+    for (int i = 0; i < 1000; i++) {
+        unsigned long long a = now_ns();
+        unsigned long long b = now_ns();
+        if (b - a < best) best = b - a;
+    }
+    clock_cost = best;
+}
+
+/** xorshift32: a cheap, repeatable random stream for shuffling */
+static unsigned int rng_state = 2463534242u;
+static unsigned int rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void shuffle(unsigned int* keys, unsigned int n) {
+    for (unsigned int i = n; i > 1; i--) {
+        unsigned int j = rng() % i;
+        unsigned int t = keys[i - 1];
+        keys[i - 1] = keys[j];
+        keys[j] = t;
+    }
+}
+
+/**
+ * Latency samples of one operation.
+ */
+typedef struct {
+    unsigned int* ns;
+    unsigned int count;
+} Samples;
+
+static void sample(Samples* s, unsigned long long start, unsigned long long end) {
+    unsigned long long d = end - start;
+    d = d > clock_cost ? d - clock_cost : 0;
+    s->ns[s->count++] = (unsigned int)d;
+}
+
+static int compare_uint(const void* a, const void* b) {
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Print a row for op: latencies from s, throughput from batch_ns, the time
+ * the same s->count operations took run back to back.
+ */
+static void report(const char* backend, const char* keys, unsigned int n,
+                   const char* load, const char* op, Samples* s, unsigned long long batch_ns) {
+    if (!s->count) return;
+    qsort(s->ns, s->count, sizeof(unsigned int), compare_uint);
+    double sum = 0;
+    for (unsigned int i = 0; i < s->count; i++) sum += s->ns[i];
+    double mean = sum / s->count;
+    printf("%-8s %-7s %6u %5s  %-12s %7.1f %6u %6u %6u %7u %8.1f\n",
+           backend, keys, n, load, op, mean,
+           s->ns[s->count / 2], s->ns[s->count * 90 / 100],
+           s->ns[s->count * 99 / 100], s->ns[s->count - 1],
+           batch_ns ? s->count * 1000.0 / batch_ns : 0.0);
+}
+
+static void report_histogram(HashTable* table, int backend) {
+    HashTableStats stats;
+    getHashTableStats(table, &stats);
+    printf("    %s:", backend == HASH_OPEN ? "probe groups" : "chain lengths");
+    for (int i = 0; i < HASH_STATS_BINS; i++) {
+        printf(" %d%s:%u", i, i == HASH_STATS_BINS - 1 ? "+" : "", stats.histogram[i]);
+    }
+    printf("  (max %u, %u items in %u %s)\n", stats.max_chain, stats.num_items,
+           stats.num_buckets, backend == HASH_OPEN ? "slots" : "buckets");
+}
+
+/**
+ * Create a table for n items at the given load (chained only).
+ */
+static HashTable* make_table(int backend, unsigned int n, unsigned int load) {
+    HashTable* table;
+    if (backend == HASH_OPEN) {
+        table = createHashTableWithBackend(bench_hash, MAP_BUCKETS, HASH_OPEN);
+    } else if (load) {
+        unsigned int buckets = n * 100 / load;
+        table = createHashTable(bench_hash, buckets ? buckets : 1);
+        setHashTableLoadFactors(table, 0, 0); // Hold the load factor fixed
+    } else {
+        table = createHashTable(bench_hash, MAP_BUCKETS);
+    }
+    // Values point at static data, which a pooled table never frees
+    enableValuePool(table, sizeof(int));
+    return table;
+}
+
+static int dummy_value;
+
+/**
+ * A key that is not in table, from the distribution's miss range if one can
+ * be found there. Inserted keys that come up (cantor) are skipped.
+ */
+static unsigned int miss_key(HashTable* table, int dist, unsigned int n) {
+    for (int tries = 0; tries < 64; tries++) {
+        unsigned int key = make_key(dist, n + rng() % n, n);
+        if (!getItem(table, key)) return key;
+    }
+    // Fall back to keys spread over all 32 bits
+    unsigned int key;
+    do key = scramble(rng()); while (getItem(table, key));
+    return key;
+}
+
+static void run_config(int backend, int dist, unsigned int n, unsigned int load) {
+    const char* backend_name = backend == HASH_OPEN ? "open" : "chained";
+    char load_name[16];
+    if (load) snprintf(load_name, sizeof(load_name), "%.1f", load / 100.0);
+    else snprintf(load_name, sizeof(load_name), "auto");
+
+    unsigned int lookups = n < MIN_LOOKUPS ? MIN_LOOKUPS : n;
+    unsigned int* keys = (unsigned int*)malloc(n * sizeof(unsigned int));
+    unsigned int* probe = (unsigned int*)malloc(lookups * sizeof(unsigned int));
+    Samples s;
+    s.ns = (unsigned int*)malloc((n > lookups ? n : lookups) * sizeof(unsigned int));
+
+    for (unsigned int i = 0; i < n; i++) keys[i] = make_key(dist, i, n);
+    shuffle(keys, n);
+
+    // insertItem, in random order, into a table timed per operation and a
+    // second one timed as a batch
+    HashTable* table = make_table(backend, n, load);
+    s.count = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        unsigned long long t0 = now_ns();
+        insertItem(table, keys[i], &dummy_value);
+        sample(&s, t0, now_ns());
+    }
+    HashTable* batch = make_table(backend, n, load);
+    unsigned long long t0 = now_ns();
+    for (unsigned int i = 0; i < n; i++) insertItem(batch, keys[i], &dummy_value);
+    report(backend_name, key_names[dist], n, load_name, "insert", &s, now_ns() - t0);
+
+    // getItem at several hit ratios
+    static const int hit_percents[] = { 100, 50, 0 };
+    for (int h = 0; h < 3; h++) {
+        for (unsigned int i = 0; i < lookups; i++) {
+            if ((rng() % 100) < (unsigned int)hit_percents[h]) probe[i] = keys[rng() % n];
+            else probe[i] = miss_key(table, dist, n);
+        }
+        s.count = 0;
+        void* volatile sink;
+        for (unsigned int i = 0; i < lookups; i++) {
+            unsigned long long t0 = now_ns();
+            sink = getItem(table, probe[i]);
+            sample(&s, t0, now_ns());
+        }
+        t0 = now_ns();
+        for (unsigned int i = 0; i < lookups; i++) sink = getItem(table, probe[i]);
+        unsigned long long batch_ns = now_ns() - t0;
+        (void)sink;
+        char op[16];
+        snprintf(op, sizeof(op), "get %d%%hit", hit_percents[h]);
+        report(backend_name, key_names[dist], n, load_name, op, &s, batch_ns);
+    }
+    report_histogram(table, backend);
+
+    // removeItem, in a different random order
+    shuffle(keys, n);
+    s.count = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        unsigned long long t0 = now_ns();
+        removeItem(table, keys[i]);
+        sample(&s, t0, now_ns());
+    }
+    t0 = now_ns();
+    for (unsigned int i = 0; i < n; i++) removeItem(batch, keys[i]);
+    report(backend_name, key_names[dist], n, load_name, "remove", &s, now_ns() - t0);
+    destroyHashTable(table);
+    destroyHashTable(batch);
+
+    // destroyHashTable of a full table, reported per item
+    table = make_table(backend, n, load);
+    for (unsigned int i = 0; i < n; i++) insertItem(table, keys[i], &dummy_value);
+    t0 = now_ns();
+    destroyHashTable(table);
+    unsigned long long total = now_ns() - t0;
+    printf("%-8s %-7s %6u %5s  %-12s %7.1f  (%.1f us total)\n", backend_name,
+           key_names[dist], n, load_name, "destroy/item", (double)total / n, total / 1000.0);
+
+    free(keys);
+    free(probe);
+    free(s.ns);
+}
+
+int main(int argc, char** argv) {
+    int quick = 0;
+    int only = -1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-q")) {
+            quick = 1;
+        } else if (!strcmp(argv[i], "-k") && i + 1 < argc) {
+            i++;
+            for (int d = 0; d < NUM_DISTS; d++) if (!strcmp(argv[i], key_names[d])) only = d;
+            if (only < 0) {
+                fprintf(stderr, "unknown key distribution %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-H") && i + 1 < argc) {
+            i++;
+            if (!strcmp(argv[i], "identity")) bench_hash = identity_hash;
+            else if (!strcmp(argv[i], "mix")) bench_hash = mix_hash;
+            else {
+                fprintf(stderr, "unknown hash %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [-q] [-k seq|random|cantor|packed|morton] [-H mix|identity]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static const unsigned int sizes[] = { 64, 1024, 16384 };
+    int num_sizes = quick ? 2 : 3;
+
+    measure_clock_cost();
+    printf("# latencies in ns (clock read cost %llu ns subtracted)\n", clock_cost);
+    printf("%-8s %-7s %6s %5s  %-12s %7s %6s %6s %6s %7s %8s\n", "backend", "keys", "n",
+           "load", "op", "mean", "p50", "p90", "p99", "max", "Mops/s");
+
+    for (int dist = 0; dist < NUM_DISTS; dist++) {
+        if (only >= 0 && dist != only) continue;
+        for (int sz = 0; sz < num_sizes; sz++) {
+            for (unsigned int l = 0; l < NUM_LOADS; l++) {
+                run_config(HASH_CHAINED, dist, sizes[sz], loads[l]);
+            }
+            run_config(HASH_OPEN, dist, sizes[sz], 0);
+        }
+    }
+    return 0;
+}
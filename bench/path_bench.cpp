@@ -0,0 +1,256 @@
+/*
+ * path_bench: cost per game tick of moving enemies toward the player with
+ * path.cpp, versus the number of enemies, on large random maps.
+ *
+ * Every tick the player takes a step, heading straight on and turning at
+ * random, and each enemy takes one step toward it. An enemy that catches the
+ * player starts over somewhere else, so the enemies stay spread out at all
+ * distances instead of trailing the player. Two strategies are compared:
+ *
+ *      astar   every enemy runs its own path_find to the player
+ *      flow    the flow field is pointed at the player and swept with a fixed
+ *              budget (-b); enemies inside its window read their step from it,
+ *              the rest fall back to path_find
+ *
+ * Enemies (re)start within SPAWN_RADIUS tiles of the player, where chasing
+ * matters, and only where they can reach it. They are not put on the map, so they do not block each other and
+ * every configuration walks the same map. Build and run with
+ *
+ *      make -C bench run-path
+ *
+ * Options:
+ *
+ *      -q          quick run (smaller maps, fewer ticks)
+ *      -b cells    flow field sweep budget per tick (default 128, the game's)
+ *      -w percent  share of wall tiles (default 25)
+ *
+ * Times are per tick in microseconds.
+ */
+#include "globals.h"
+#include "map.h"
+#include "path.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MAP 0       // Map slot the benchmark builds its maps in
+#define SPAWN_RADIUS 14    // Most spawns land inside the flow field window
+
+static unsigned long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/** xorshift32: a cheap, repeatable random stream */
+static unsigned int rng_state = 2463534242u;
+static unsigned int rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int compare_uint(const void* a, const void* b) {
+    unsigned int x = *(const unsigned int*)a, y = *(const unsigned int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Cells reachable from the player's start; random walls leave pockets, and
+ * an enemy spawned in one would never get anywhere.
+ */
+static unsigned char* reachable;
+static int reach_size;
+
+/** Flood fill reachable from (x,y), returning the number of cells reached */
+static int fill_reachable(int size, int x, int y) {
+    static const int dx[4] = { 0, 0, 1, -1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    int* stack = (int*)malloc(size * size * sizeof(int));
+    int top = 0, count = 1;
+    memset(reachable, 0, size * size);
+    reachable[y * size + x] = 1;
+    stack[top++] = y * size + x;
+    while (top) {
+        int c = stack[--top];
+        for (int d = 0; d < 4; d++) {
+            int nx = c % size + dx[d], ny = c / size + dy[d];
+            if (nx < 0 || ny < 0 || nx >= size || ny >= size) continue;
+            if (reachable[ny * size + nx] || map_blocked(nx, ny)) continue;
+            reachable[ny * size + nx] = 1;
+            stack[top++] = ny * size + nx;
+            count++;
+        }
+    }
+    free(stack);
+    return count;
+}
+
+static int is_reachable(int x, int y) {
+    return x >= 0 && y >= 0 && x < reach_size && y < reach_size && reachable[y * reach_size + x];
+}
+
+/**
+ * Build a size x size map with a wall border and wall_percent random walls,
+ * make it the active map, and find the cells reachable from within it.
+ */
+static void build_map(int size, int wall_percent) {
+    char* cells = (char*)malloc(size * size);
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            int edge = x == 0 || y == 0 || x == size - 1 || y == size - 1;
+            cells[y * size + x] = edge || (int)(rng() % 100) < wall_percent ? 'W' : ' ';
+        }
+    }
+    map_build(BENCH_MAP, cells, size, size, NULL);
+    set_active_map(BENCH_MAP);
+    free(cells);
+
+    // Keep the largest part of the map that is in one piece: flood fill from
+    // random open cells until one reaches at least half the map
+    free(reachable);
+    reachable = (unsigned char*)malloc(size * size);
+    reach_size = size;
+    int x, y;
+    do {
+        do {
+            x = rng() % size;
+            y = rng() % size;
+        } while (map_blocked(x, y));
+    } while (fill_reachable(size, x, y) < size * size / 2);
+}
+
+/** A random reachable cell of the map */
+static void random_cell(int size, int* x, int* y) {
+    do {
+        *x = rng() % size;
+        *y = rng() % size;
+    } while (!is_reachable(*x, *y));
+}
+
+/** A random reachable cell at most radius tiles from (cx,cy) on each axis */
+static void random_cell_near(int cx, int cy, int radius, int* x, int* y) {
+    do {
+        *x = cx - radius + (int)(rng() % (2 * radius + 1));
+        *y = cy - radius + (int)(rng() % (2 * radius + 1));
+    } while (!is_reachable(*x, *y) || (*x == cx && *y == cy));
+}
+
+/**
+ * Move (*x,*y) one step in direction *dir, turning to a random open direction
+ * when that is blocked or, now and then, for no reason.
+ */
+static void wander(int* x, int* y, int* dir) {
+    static const int dx[4] = { 0, 0, 1, -1 };
+    static const int dy[4] = { -1, 1, 0, 0 };
+    if (rng() % 8 == 0 || map_blocked(*x + dx[*dir], *y + dy[*dir])) {
+        int d = rng() % 4;
+        for (int i = 0; i < 4 && map_blocked(*x + dx[d], *y + dy[d]); i++) d = (d + 1) % 4;
+        *dir = d;
+    }
+    if (!map_blocked(*x + dx[*dir], *y + dy[*dir])) {
+        *x += dx[*dir];
+        *y += dy[*dir];
+    }
+}
+
+#define STRATEGY_ASTAR 0
+#define STRATEGY_FLOW  1
+
+static void run_config(int size, int strategy, int enemies, int ticks, int budget) {
+    int* ex = (int*)malloc(enemies * sizeof(int));
+    int* ey = (int*)malloc(enemies * sizeof(int));
+    unsigned int* ns = (unsigned int*)malloc(ticks * sizeof(unsigned int));
+    int px, py, dir = 0;
+
+    // The same start for both strategies
+    rng_state = 12345u + size * 7 + enemies;
+    random_cell(size, &px, &py);
+    for (int i = 0; i < enemies; i++) random_cell_near(px, py, SPAWN_RADIUS, &ex[i], &ey[i]);
+
+    unsigned long searches = 0, field_steps = 0, unreached = 0;
+    for (int t = 0; t < ticks; t++) {
+        wander(&px, &py, &dir);
+        unsigned long long t0 = now_ns();
+        if (strategy == STRATEGY_FLOW) {
+            flow_set_target(px, py);
+            flow_update(budget);
+        }
+        for (int i = 0; i < enemies; i++) {
+            int dx = 0, dy = 0;
+            if (strategy == STRATEGY_FLOW && flow_step(ex[i], ey[i], &dx, &dy) != FLOW_UNKNOWN) {
+                field_steps++;
+            } else {
+                if (path_find(ex[i], ey[i], px, py, &dx, &dy) < 0) unreached++;
+                searches++;
+            }
+            ex[i] += dx;
+            ey[i] += dy;
+        }
+        ns[t] = (unsigned int)(now_ns() - t0);
+
+        // Enemies that caught the player start over, outside the timing
+        for (int i = 0; i < enemies; i++) {
+            int ax = ex[i] - px, ay = ey[i] - py;
+            if ((ax < 0 ? -ax : ax) + (ay < 0 ? -ay : ay) <= 1) {
+                random_cell_near(px, py, SPAWN_RADIUS, &ex[i], &ey[i]);
+            }
+        }
+    }
+
+    qsort(ns, ticks, sizeof(unsigned int), compare_uint);
+    double sum = 0;
+    for (int t = 0; t < ticks; t++) sum += ns[t];
+    double mean = sum / ticks / 1000.0;
+    printf("%5d %-6s %5d  %9.1f %7.1f %7.1f %7.1f  %8.2f  %5.1f%% %5.1f%%\n",
+           size, strategy == STRATEGY_FLOW ? "flow" : "astar", enemies, mean,
+           ns[ticks / 2] / 1000.0, ns[ticks * 99 / 100] / 1000.0, ns[ticks - 1] / 1000.0,
+           mean / enemies,
+           100.0 * field_steps / ((double)ticks * enemies),
+           searches ? 100.0 * unreached / searches : 0.0);
+
+    free(ex);
+    free(ey);
+    free(ns);
+}
+
+int main(int argc, char** argv) {
+    int quick = 0;
+    int budget = 128;
+    int wall_percent = 25;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-q")) {
+            quick = 1;
+        } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            budget = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            wall_percent = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-q] [-b cells] [-w percent]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static const int sizes[] = { 64, 256 };
+    static const int counts[] = { 1, 4, 16, 64, 256 };
+    int ticks = quick ? 50 : 300;
+
+    maps_init();
+    printf("# microseconds per tick; flow budget %d cells/tick, %d%% walls\n", budget, wall_percent);
+    printf("# field: share of enemy steps read from the flow field\n");
+    printf("# gave up: share of path_find calls that hit PATH_MAX_NODES or found no path\n");
+    printf("%5s %-6s %5s  %9s %7s %7s %7s  %8s  %6s %6s\n", "map", "method", "enemy",
+           "mean", "p50", "p99", "max", "/enemy", "field", "gave up");
+    for (int s = 0; s < (quick ? 1 : 2); s++) {
+        rng_state = 777u + s;
+        build_map(sizes[s], wall_percent);
+        for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            run_config(sizes[s], STRATEGY_ASTAR, counts[c], ticks, budget);
+            run_config(sizes[s], STRATEGY_FLOW, counts[c], ticks, budget);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "entity.h"
+#include "path.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Entity storage, one array per field, indexed by id. A slot is free when its
+ * map is NULL. count is one past the highest slot in use, so the loops over
+ * all entities stop there.
+ */
+static struct {
+    short x[MAX_ENTITIES], y[MAX_ENTITIES];
+    signed char dir[MAX_ENTITIES];          // +1 or -1 along the patrol axis
+    unsigned char health[MAX_ENTITIES];
+    unsigned char behavior[MAX_ENTITIES];
+    unsigned char kind[MAX_ENTITIES];       // Tile kind it is drawn as
+    Map* map[MAX_ENTITIES];                 // Owning map, NULL if free
+    int count;
+} ents;
+
+/**
+ * Occupancy of the active map: one bit per cell of its w x h rectangle, set
+ * where an entity stands, so looking up an empty cell never scans the
+ * entities. Rebuilt when the active map (or its size) changes. Cells outside
+ * the rectangle have no bit and are always scanned for.
+ */
+static struct {
+    unsigned int* bits;
+    int words;              // Size of bits
+    Map* map;               // Map the bits describe
+    int w, h;
+} occ;
+
+static int in_rect(int x, int y)
+{
+    return x >= 0 && y >= 0 && x < occ.w && y < occ.h;
+}
+
+static void set_occupied(int x, int y, int on)
+{
+    if (!in_rect(x, y)) return;
+    int cell = y * occ.w + x;
+    if (on) occ.bits[cell >> 5] |= 1u << (cell & 31);
+    else occ.bits[cell >> 5] &= ~(1u << (cell & 31));
+}
+
+/**
+ * Make occ describe the active map.
+ */
+static void sync_occupancy()
+{
+    Map* map = get_active_map();
+    int w = map_width(), h = map_height();
+    if (map == occ.map && w == occ.w && h == occ.h) return;
+
+    int words = (w * h + 31) / 32;
+    if (words > occ.words) {
+        free(occ.bits);
+        occ.bits = (unsigned int*) malloc(words * sizeof(unsigned int));
+        occ.words = occ.bits ? words : 0;
+        // Without the bits every cell is outside the rectangle: scan always
+        if (!occ.bits) w = h = 0;
+    }
+    occ.map = map;
+    occ.w = w;
+    occ.h = h;
+    if (occ.bits) memset(occ.bits, 0, occ.words * sizeof(unsigned int));
+    for (int i = 0; i < ents.count; i++) {
+        if (ents.map[i] == map) set_occupied(ents.x[i], ents.y[i], 1);
+    }
+}
+
+/**
+ * Id of the entity at (x,y) of occ.map, or -1. occ must be in sync.
+ */
+static int find_entity(int x, int y)
+{
+    if (in_rect(x, y)) {
+        int cell = y * occ.w + x;
+        if (!((occ.bits[cell >> 5] >> (cell & 31)) & 1)) return -1;
+    }
+    for (int i = 0; i < ents.count; i++) {
+        if (ents.map[i] == occ.map && ents.x[i] == x && ents.y[i] == y) return i;
+    }
+    return -1;
+}
+
+static void remove_entity(int i)
+{
+    if (ents.map[i] == occ.map) set_occupied(ents.x[i], ents.y[i], 0);
+    if (ents.map[i] == get_active_map()) map_mark_dirty(ents.x[i], ents.y[i]);
+    ents.map[i] = NULL;
+    while (ents.count > 0 && !ents.map[ents.count - 1]) ents.count--;
+}
+
+int entity_spawn(int kind, int x, int y, int behavior, int health)
+{
+    sync_occupancy();
+    if (find_entity(x, y) >= 0) return -1;
+
+    int i = 0;
+    while (i < ents.count && ents.map[i]) i++;
+    if (i == MAX_ENTITIES) return -1;
+    if (i == ents.count) ents.count++;
+
+    ents.x[i] = x;
+    ents.y[i] = y;
+    ents.dir[i] = behavior == BEHAVIOR_PATROL_V ? -1 : 1;
+    ents.health[i] = health < 1 ? 1 : health > 255 ? 255 : health;
+    ents.behavior[i] = behavior;
+    ents.kind[i] = kind;
+    ents.map[i] = occ.map;
+    set_occupied(x, y, 1);
+    map_mark_dirty(x, y);
+    return i;
+}
+
+void entities_clear(Map* map)
+{
+    for (int i = 0; i < ents.count; i++) {
+        if (ents.map[i] == map) remove_entity(i);
+    }
+}
+
+int entity_damage(int id, int amount)
+{
+    if (!entity_alive(id)) return 0;
+    if (ents.health[id] > amount) {
+        ents.health[id] -= amount;
+        return 0;
+    }
+    remove_entity(id);
+    return 1;
+}
+
+int entity_alive(int id)
+{
+    return id >= 0 && id < ents.count && ents.map[id] != NULL;
+}
+
+int entity_x(int id) { return ents.x[id]; }
+int entity_y(int id) { return ents.y[id]; }
+int entity_kind(int id) { return ents.kind[id]; }
+
+int entity_at(int x, int y)
+{
+    sync_occupancy();
+    return find_entity(x, y);
+}
+
+int entity_neighbors(int x, int y)
+{
+    sync_occupancy();
+    return (find_entity(x, y - 1) >= 0 ? BLOCKED_N : 0)
+         | (find_entity(x, y + 1) >= 0 ? BLOCKED_S : 0)
+         | (find_entity(x + 1, y) >= 0 ? BLOCKED_E : 0)
+         | (find_entity(x - 1, y) >= 0 ? BLOCKED_W : 0);
+}
+
+/**
+ * Move entity i by (dx,dy) unless the terrain, another entity or the player
+ * at (px,py) is in the way. Returns nonzero if it moved.
+ */
+static int try_move(int i, int dx, int dy, int px, int py)
+{
+    int nx = ents.x[i] + dx, ny = ents.y[i] + dy;
+    if ((nx == px && ny == py) || map_blocked(nx, ny) || find_entity(nx, ny) >= 0) return 0;
+
+    set_occupied(ents.x[i], ents.y[i], 0);
+    map_mark_dirty(ents.x[i], ents.y[i]);
+    ents.x[i] = nx;
+    ents.y[i] = ny;
+    set_occupied(nx, ny, 1);
+    map_mark_dirty(nx, ny);
+    return 1;
+}
+
+void entities_update(int px, int py)
+{
+    sync_occupancy();
+    for (int i = 0; i < ents.count; i++) {
+        if (ents.map[i] != occ.map || ents.behavior[i] == BEHAVIOR_NONE) continue;
+
+        // Close to the player: follow the flow field, or wait if the way
+        // is taken
+        int dx, dy;
+        if (flow_step(ents.x[i], ents.y[i], &dx, &dy) < CHASE_RANGE) {
+            try_move(i, dx, dy, px, py);
+            continue;
+        }
+
+        // Patrol, turning around instead of moving when blocked
+        dx = ents.behavior[i] == BEHAVIOR_PATROL_H ? ents.dir[i] : 0;
+        dy = ents.behavior[i] == BEHAVIOR_PATROL_V ? ents.dir[i] : 0;
+        if (!try_move(i, dx, dy, px, py)) ents.dir[i] = -ents.dir[i];
+    }
+}
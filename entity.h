@@ -0,0 +1,86 @@
+#ifndef ENTITY_H
+#define ENTITY_H
+
+#include "map.h"
+
+/**
+ * Entities: the things on a map that move (the dragon, the goblin, and as
+ * many more mobs as a map wants). The map itself only holds static terrain;
+ * entities live here, in parallel arrays indexed by entity id, and are drawn
+ * on top of the tile they stand on.
+ *
+ * Every entity belongs to the map that was active when it was spawned, and
+ * only the entities of the active map move, block or show up in entity_at.
+ * Cells holding an entity count as blocked for other entities and for the
+ * player, but not for map_blocked or the pathfinding, which see terrain only.
+ *
+ * Ids stay valid until the entity dies or is cleared; a dead entity's id may
+ * then be reused by a later entity_spawn.
+ */
+
+/**
+ * The most entities alive at once, over all maps.
+ */
+#define MAX_ENTITIES 128
+
+// Behaviors: what an entity does on each entities_update
+#define BEHAVIOR_NONE       0   // Stands still
+#define BEHAVIOR_PATROL_H   1   // Walks east and west, turning at obstacles
+#define BEHAVIOR_PATROL_V   2   // Walks north and south, turning at obstacles
+
+/**
+ * Patrolling entities closer to the player than this many steps (by the
+ * flow field, see path.h) stop patrolling and chase the player instead.
+ */
+#define CHASE_RANGE 6
+
+/**
+ * Add an entity drawn as tile kind kind (TILE_DRAGON...) at (x,y) of the
+ * active map. Patrols start heading east (PATROL_H) or north (PATROL_V).
+ * Returns its id, or -1 if MAX_ENTITIES are already alive or another entity
+ * stands at (x,y).
+ */
+int entity_spawn(int kind, int x, int y, int behavior, int health);
+
+/**
+ * Remove every entity of map (see get_map), e.g. before the map is reloaded.
+ */
+void entities_clear(Map* map);
+
+/**
+ * Take health from an entity; it dies (and is removed) when its health
+ * reaches zero. Returns nonzero if it died.
+ */
+int entity_damage(int id, int amount);
+
+/**
+ * Returns nonzero if id is a live entity.
+ */
+int entity_alive(int id);
+
+/**
+ * Position and tile kind of a live entity.
+ */
+int entity_x(int id);
+int entity_y(int id);
+int entity_kind(int id);
+
+/**
+ * Returns the id of the entity at (x,y) of the active map, or -1.
+ */
+int entity_at(int x, int y);
+
+/**
+ * Returns the BLOCKED_* bits (see map.h) of the four cells next to (x,y) that
+ * an entity stands on.
+ */
+int entity_neighbors(int x, int y);
+
+/**
+ * Move every entity of the active map one step according to its behavior.
+ * (px,py) is the player, whose cell entities never step onto. Cells an
+ * entity leaves or enters are marked dirty (see map_mark_dirty).
+ */
+void entities_update(int px, int py);
+
+#endif // ENTITY_H
@@ -3,7 +3,7 @@
 
 #define HEIGHT 50
 #define WIDTH 50
-#define NUM_BUCKETS 50
+#define NUM_BUCKETS 50  // Initial bucket count; map tables grow as they fill
 
 // Include all the hardware libraries
 #include "mbed.h"
@@ -26,9 +26,9 @@ extern uLCD_4DGL uLCD;      // LCD Screen
 extern SDFileSystem sd;     // SD Card
 extern Serial pc;           // USB Console output
 extern MMA8452 acc;       // Accelerometer
-extern DigitalIn button1;   // Pushbuttons
-extern DigitalIn button2;
-extern DigitalIn button3;
+extern InterruptIn button1; // Pushbuttons
+extern InterruptIn button2;
+extern InterruptIn button3;
 extern AnalogOut DACout;    // Speaker
 extern PwmOut speaker;
 extern wave_player waver;
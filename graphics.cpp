@@ -1,5 +1,7 @@
 #include "graphics.h"
 #include "globals.h"
+#include "sprites.h"
+#include "profile.h"
 
 /*
 In this file put all your graphical functions (don't forget to declare them first
@@ -15,8 +17,61 @@ This website is a good resource.
 #define DIRT   BROWN
 #define PURPLE 0x800080
 
+/**
+ * Off-screen compositing buffer. Between fb_begin and fb_end, tiles are drawn
+ * into this buffer instead of being sent to the LCD one by one, and fb_end
+ * sends the whole rectangle with a single BLIT. It holds one row of tiles
+ * across the play area (121x11), which is the largest burst draw_game sends.
+ */
+#define FB_MAX_W 121
+#define FB_MAX_H 11
+static int fb[FB_MAX_W * FB_MAX_H];
+static int fb_u, fb_v, fb_w, fb_h;
+static int fb_open;
+
+void fb_begin(int u, int v, int w, int h)
+{
+    fb_u = u;
+    fb_v = v;
+    fb_w = (w < FB_MAX_W) ? w : FB_MAX_W;
+    fb_h = (h < FB_MAX_H) ? h : FB_MAX_H;
+    fb_open = 1;
+}
+
+void fb_end()
+{
+    if (!fb_open) return;
+    fb_open = 0;
+    PROFILE_SCOPE(PROFILE_BLIT);
+    // BLIT waits for the display's ACK, so no recovery time is needed
+    uLCD.BLIT(fb_u, fb_v, fb_w, fb_h, fb);
+}
+
+/**
+ * Copy (or fill, if colors is NULL) an 11x11 tile at (u,v) into the
+ * compositing buffer, clipped to the open rectangle.
+ */
+static void fb_tile(int u, int v, const int* colors, int fill)
+{
+    for (int row = 0; row < 11; row++) {
+        int y = v + row - fb_v;
+        if (y < 0 || y >= fb_h) continue;
+        for (int col = 0; col < 11; col++) {
+            int x = u + col - fb_u;
+            if (x < 0 || x >= fb_w) continue;
+            fb[y * fb_w + x] = colors ? colors[row * 11 + col] : fill;
+        }
+    }
+}
+
 void draw_img(int u, int v, int* colors)
 {
+    // Composite into the off-screen buffer if a burst is being built
+    if (fb_open) {
+        fb_tile(u, v, colors, 0);
+        return;
+    }
+
 //    int colors[11*11];
 //    for (int i = 0; i < 11*11; i++)
 //    {
@@ -29,8 +84,55 @@ void draw_img(int u, int v, int* colors)
 //        else colors[i] = BLACK;
 //    }
 
+    PROFILE_SCOPE(PROFILE_BLIT);
     uLCD.BLIT(u, v, 11, 11, colors);
-    wait_us(250); // Recovery time!
+}
+
+/**
+ * sprite_palette expanded to the 0xRRGGBB ints BLIT takes. BLIT keeps only the
+ * top 5/6/5 bits of each channel, so this sends exactly the palette colors.
+ */
+static int sprite_colors[16];
+static int sprite_colors_ready;
+
+/**
+ * Draw sprite id from the atlas at (u,v). Inside an fb_begin rectangle the
+ * pixels are expanded straight into the compositing buffer; otherwise they are
+ * expanded into one static tile and sent with draw_img.
+ */
+static void draw_sprite(int u, int v, int id)
+{
+    static int tile[SPRITE_W * SPRITE_H];
+
+    if (!sprite_colors_ready) {
+        for (int i = 0; i < 16; i++) {
+            int c = sprite_palette[i];
+            sprite_colors[i] = ((c >> 11) & 0x1F) << 19 | ((c >> 5) & 0x3F) << 10 | (c & 0x1F) << 3;
+        }
+        sprite_colors_ready = 1;
+    }
+
+    int* dst = tile;
+    int stride = SPRITE_W;
+    int direct = fb_open && u >= fb_u && v >= fb_v
+              && u + SPRITE_W <= fb_u + fb_w && v + SPRITE_H <= fb_v + fb_h;
+    if (direct) {
+        dst = &fb[(v - fb_v) * fb_w + (u - fb_u)];
+        stride = fb_w;
+    }
+
+    const unsigned char* src = sprite_atlas[id];
+    for (int row = 0; row < SPRITE_H; row++) {
+        for (int col = 0; col < SPRITE_W; col += 2) {
+            unsigned char two = src[col >> 1];
+            dst[col] = sprite_colors[two >> 4];
+            if (col + 1 < SPRITE_W) dst[col + 1] = sprite_colors[two & 0x0F];
+        }
+        src += SPRITE_ROW_BYTES;
+        dst += stride;
+    }
+
+    if (!direct) draw_img(u, v, tile);
 }
 
 void draw_player(int u, int v, int key)
@@ -38,91 +140,38 @@ void draw_player(int u, int v, int key)
     //uLCD.filled_rectangle(u, v, u+11, v+11, RED); // <-- DEFULT PLAYER
 
     if(!key) {  // Player with NO KEY
-        int player[121] = {
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff000000, 0xff000000, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff000000, 0xff000000, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff000000, 0xff000000, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff000000, 0xff000000, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 
-                            0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13, 0xff00ff13
-                        };
-
-        draw_img(u, v, player);
+        draw_sprite(u, v, SPRITE_PLAYER);
     }
     else {  // Player with KEY (same as KEY icon)
-        int player[121] = {
-                            0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000
-                        };
-
-        draw_img(u, v, player);
+        draw_sprite(u, v, SPRITE_PLAYER_KEY);
     }
 }
 
 void draw_nothing(int u, int v)
 {
     // Fill a tile with blackness
-    uLCD.filled_rectangle(u, v, u+10, v+10, BLACK);
+    if (fb_open) fb_tile(u, v, NULL, BLACK);
+    else uLCD.filled_rectangle(u, v, u+10, v+10, BLACK);
 }
 
 void draw_wall(int u, int v)
 {
     //uLCD.filled_rectangle(u, v, u+10, v+10, BROWN); // <-- DEFAULT WALL
     
-    int wall[121] = {
-                        0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 
-                        0xff848484, 0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 0xff848484, 
-                        0xff848484, 0xff848484, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff848484, 0xff848484, 
-                        0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 
-                        0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 
-                        0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 
-                        0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 
-                        0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 0xff848484, 0xff848484, 
-                        0xff848484, 0xff848484, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff848484, 0xff848484, 
-                        0xff848484, 0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000, 0xff848484, 
-                        0xff000000, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff848484, 0xff000000
-                    };
-
-        draw_img(u, v, wall);
+    draw_sprite(u, v, SPRITE_WALL);
 }
 
 void draw_plant(int u, int v)
 {
     //uLCD.filled_rectangle(u, v, u+10, v+10, GREEN); // <-- DEFAULT PLANT
     
-    int plant[121] = {
-                        0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 
-                        0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 
-                        0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 
-                        0xffff00a2, 0xff1e69d2, 0xff1e69d2, 0xffff00a2, 0xffff00a2, 0xff1e69d2, 0xffff00a2, 0xffff00a2, 0xff1e69d2, 0xff1e69d2, 0xffff00a2, 
-                        0xffff00a2, 0xffff00a2, 0xff1e69d2, 0xff1e69d2, 0xffff00a2, 0xff1e69d2, 0xffff00a2, 0xff1e69d2, 0xff1e69d2, 0xffff00a2, 0xffff00a2, 
-                        0xffff00a2, 0xffff00a2, 0xffff00a2, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0xffff00a2, 0xffff00a2, 0xffff00a2, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xff1e69d2, 0xff1e69d2, 0xff1e69d2, 0x00000000, 0x00000000, 0x00000000, 0x00000000
-                    };
-
-        draw_img(u, v, plant);
+    draw_sprite(u, v, SPRITE_PLANT);
 }
 
 void draw_upper_status(int x, int y, int px, int py)
 {
+    PROFILE_SCOPE(PROFILE_STATUS);
+
     // Draw bottom border of status bar
     uLCD.line(0, 9, 127, 9, GREEN);
 
@@ -138,6 +187,8 @@ void draw_upper_status(int x, int y, int px, int py)
 
 void draw_lower_status(int health, int phealth)
 {
+    PROFILE_SCOPE(PROFILE_STATUS);
+
     // Draw top border of status bar
     uLCD.line(0, 118, 127, 118, GREEN);
 
@@ -161,202 +212,55 @@ void draw_border()
 
 void draw_npc_wizard(int u, int v)
 {
-    int wizard[121] = {
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 
-                        0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 
-                        0xffffa600, 0xff000000, 0xff000000, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xff000000, 0xff000000, 0xffffa600, 
-                        0xffffa600, 0xffffa600, 0xff000000, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xff000000, 0xffffa600, 
-                        0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xff000000, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 
-                        0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xff000000, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 
-                        0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffa600, 0xff000000, 0xff000000, 0xff000000, 0xffffa600, 0xffffffff, 0xffffffff, 0xffffffff, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff
-                    };
-                    
-    draw_img(u, v, wizard);
+    draw_sprite(u, v, SPRITE_WIZARD);
 }
 
 void draw_key(int u, int v)
 {
-    int key[121] = {
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                    0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000
-                };
-                
-    draw_img(u, v, key);
+    draw_sprite(u, v, SPRITE_KEY);
 }
 
 void draw_spell(int u, int v) 
 {
-    int spell[121] = {
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffff0800, 0xffdbff00, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffff0800, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0xffdbff00, 0xffff0800, 0xffff0800, 0xffff0800, 0xffdbff00, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0xffdbff00, 0xffdbff00, 0xffff0800, 0xffff0800, 0xffff0800, 0xffdbff00, 0xffdbff00, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0xffdbff00, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffdbff00, 0x00000000, 0x00000000, 
-                        0xffdbff00, 0xffdbff00, 0xffdbff00, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffdbff00, 0xffdbff00, 0xffdbff00, 
-                        0xffdbff00, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffdbff00, 
-                        0xffdbff00, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffdbff00, 
-                        0xffdbff00, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffdbff00
-                    };
-    draw_img(u, v, spell);
+    draw_sprite(u, v, SPRITE_SPELL);
 }
 
 void draw_spell_dark(int u, int v) 
 {
-    int spell[121] = {
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xff0000ff, 0xff0000ff, 0xff0000ff, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 0x00000000, 0x00000000, 
-                        0x00000000, 0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 0x00000000, 
-                        0x00000000, 0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 0x00000000, 
-                        0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 
-                        0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 
-                        0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff, 
-                        0xff0000ff, 0xff0000ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff00f2ff, 0xff0000ff, 0xff0000ff
-                    };
-    draw_img(u, v, spell);
+    draw_sprite(u, v, SPRITE_SPELL_DARK);
 }
 
 void draw_chest(int u, int v) 
 {
-    int chest[121] = {
-                        0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 
-                        0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 
-                        0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 
-                        0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 
-                        0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xffffa600, 0xffffa600, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 
-                        0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xffffa600, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 
-                        0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 0xffffa600, 
-                        0xff962d00, 0xffffa600, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xffffa600, 0xff962d00, 
-                        0xff962d00, 0xffffa600, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xffffa600, 0xff962d00, 
-                        0xff962d00, 0xffffa600, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xffffa600, 0xff962d00, 
-                        0xff962d00, 0xffffa600, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xff962d00, 0xffffa600, 0xff962d00
-                    };
-                    
-    draw_img(u, v, chest);
+    draw_sprite(u, v, SPRITE_CHEST);
 }
 
 void draw_laddar(int u, int v)
 {
-    int laddar[121] = {
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0xffff0004, 0xffff0004, 0xffff0004, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 
-                        0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0xffff0004, 0x00000000, 0x00000000, 
-                        0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff
-                    };
-                    
-    draw_img(u, v, laddar);
+    draw_sprite(u, v, SPRITE_LADDAR);
 }
 
 void draw_dragon(int u, int v) 
 {
-    int dragon[121] = {
-                        0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 
-0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 
-0xff04ff00, 0xff000000, 0xff000000, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff000000, 0xff000000, 0xff04ff00, 
-0xff04ff00, 0xffff000f, 0xff000000, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xffff000f, 0xff000000, 0xff04ff00, 
-0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 
-0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff000000, 0xff04ff00, 0xff000000, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 
-0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 0xff04ff00, 
-0xff04ff00, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff04ff00, 
-0xff04ff00, 0xff000000, 0xffffffff, 0xffff000f, 0xffffffff, 0xffff000f, 0xffffffff, 0xffff000f, 0xffffffff, 0xff000000, 0xff04ff00, 
-0xff04ff00, 0xff000000, 0xffff000f, 0xffff000f, 0xffff000f, 0xffff000f, 0xffff000f, 0xffff000f, 0xffff000f, 0xff000000, 0xff04ff00, 
-0xff04ff00, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff04ff00};
-                    
-    draw_img(u, v, dragon);
+    draw_sprite(u, v, SPRITE_DRAGON);
 }
 
 void draw_goblin(int u, int v) 
 {
-    int goblin[121] = {
-                        0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff000000, 0xff000000, 0xff000000, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff000000, 0xff000000, 0xff000000, 0xff00fff6, 
-0xff00fff6, 0xff000000, 0xff0000ff, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff000000, 0xff0000ff, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff000000, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff0000ff, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff000000, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff000000, 0xff0000ff, 0xff0000ff, 0xff0000ff, 0xff0000ff, 0xff0000ff, 0xff000000, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 
-0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6, 0xff00fff6};
-                    
-    draw_img(u, v, goblin);
+    draw_sprite(u, v, SPRITE_GOBLIN);
 }
 
 void draw_grave(int u, int v) 
 {
-    int grave[121] = {
-                        0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 
-0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 
-0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 
-0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xffffffff, 
-0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 
-0xffffffff, 0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 
-0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 
-0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 
-0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xffffffff, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 
-0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 
-0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b, 0xff6b6b6b};
-                    
-    draw_img(u, v, grave);
+    draw_sprite(u, v, SPRITE_GRAVE);
 }
 
 void draw_elixir(int u, int v) 
 {
-    int elixir[121] = {
-                        0x00000000, 0x00000000, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0xffffffff, 0xffffffff, 0x00000000, 0x00000000, 
-0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 
-0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 
-0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 
-0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 
-0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 
-0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 
-0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000};
-                    
-    draw_img(u, v, elixir);
+    draw_sprite(u, v, SPRITE_ELIXIR);
 }
 
 void draw_sign(int u, int v) 
 {
-    int sign[121] = {
-                        0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 
-0xffffffff, 0xffffffff, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0xffffffff, 0xffffffff, 
-0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 
-0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 
-0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 
-0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 
-0x00000000, 0x00000000, 0x00000000, 0xffffffff, 0xffff0800, 0xffff0800, 0xffff0800, 0xffffffff, 0x00000000, 0x00000000, 0x00000000};
-                    
-    draw_img(u, v, sign);
+    draw_sprite(u, v, SPRITE_SIGN);
 }
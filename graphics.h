@@ -3,19 +3,25 @@
 
 
 /**
- * Takes a string image and draws it to the screen. The string is 121 characters
- * long, and represents an 11x11 tile in row-major ordering (across, then down,
- * like a regular multi-dimensional array). The available colors are:
- *      R = Red
- *      Y = Yellow
- *      G = Green
- *      D = Brown ("dirt")
- *      5 = Light grey (50%)
- *      3 = Dark grey (30%)
- *      Any other character is black
- * More colors can be easily added by following the pattern already given.
+ * Draws an 11x11 tile at (u,v). colors holds 121 0xRRGGBB colors in row-major
+ * ordering (across, then down, like a regular multi-dimensional array), as
+ * uLCD.BLIT takes them. Inside an fb_begin rectangle the tile goes into the
+ * off-screen buffer; otherwise it is sent to the LCD on its own.
  */
-void draw_img(int u, int v, const char* img);
+void draw_img(int u, int v, int* colors);
+
+/**
+ * Start composing the w x h screen rectangle at (u,v) off-screen (at most one
+ * row of tiles across the play area, 121x11). Until fb_end, draw_img,
+ * draw_nothing and every tile DrawFunc draw into the buffer instead of the
+ * LCD. The caller must draw every tile the rectangle covers.
+ */
+void fb_begin(int u, int v, int w, int h);
+
+/**
+ * Send the composed rectangle to the LCD in one BLIT and stop composing.
+ */
+void fb_end();
 
 /**
  * Draws the player. This depends on the player state, so it is not a DrawFunc.
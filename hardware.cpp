@@ -4,6 +4,10 @@
 #include "globals.h"
 
 #include "hardware.h"
+#include "audio.h"
+#include "profile.h"
+
+#include <math.h>
 
 // We need to actually instantiate all of the globals (i.e. declare them once
 // without the extern keyword). That's what this file does!
@@ -12,14 +16,132 @@
 uLCD_4DGL uLCD(p9,p10,p11);             // LCD Screen (tx, rx, reset)
 SDFileSystem sd(p5, p6, p7, p8, "sd");  // SD Card(mosi, miso, sck, cs)
 Serial pc(USBTX,USBRX);                 // USB Console (tx, rx)
-MMA8452 acc(p28, p27, 100000);        // Accelerometer (sda, sdc, rate)
-DigitalIn button1(p21);                 // Pushbuttons (pin)
-DigitalIn button2(p22);
-DigitalIn button3(p23);
+MMA8452 acc(p28, p27, 400000);        // Accelerometer (sda, sdc, rate)
+InterruptIn button1(p21);               // Pushbuttons (pin)
+InterruptIn button2(p22);
+InterruptIn button3(p23);
 AnalogOut DACout(p18);                  // Speaker (pin)
 PwmOut speaker(p26);
 wave_player waver(&DACout);
 
+/**
+ * Button interrupts. Each button reports a change of its level at once and
+ * then ignores its edges for DEBOUNCE_US, after which it checks the level
+ * again (the settle timeout), so bounces are never reported and a change
+ * hidden by them is not lost.
+ *
+ * The events go through a ring buffer to read_button_event. The edge and
+ * timeout interrupts all run at the same priority and never preempt each
+ * other, so together they are its single producer and the game loop its
+ * single consumer: the producer only writes head, the consumer only tail, and
+ * each publishes its index after the slot it covers, so no lock is needed.
+ */
+#define BUTTONS 3
+
+static InterruptIn* const buttons[BUTTONS] = { &button1, &button2, &button3 };
+static Timeout settle[BUTTONS];
+static volatile int down[BUTTONS];      // Debounced level, 1 while pressed
+static volatile int settling[BUTTONS];  // Edges are ignored until settle fires
+
+static ButtonEvent events[BUTTON_EVENTS];
+static volatile unsigned int head;      // Next slot to write
+static volatile unsigned int tail;      // Next slot to read
+
+static void push_event(int button, int pressed)
+{
+    if (head - tail == BUTTON_EVENTS) return;
+    ButtonEvent* e = &events[head % BUTTON_EVENTS];
+    e->button = button;
+    e->pressed = pressed;
+    e->time_us = us_ticker_read();
+    head = head + 1;
+}
+
+static void button_settled(int b);
+
+static void settled1() { button_settled(0); }
+static void settled2() { button_settled(1); }
+static void settled3() { button_settled(2); }
+static void (* const settled[BUTTONS])() = { settled1, settled2, settled3 };
+
+/**
+ * Report button b if its level differs from the debounced one, and ignore
+ * its edges until the contacts have settled.
+ */
+static void button_changed(int b)
+{
+    int pressed = !buttons[b]->read();  // Pulled up: 0 while pressed
+    if (pressed == down[b]) return;
+    down[b] = pressed;
+    push_event(b, pressed);
+    settling[b] = 1;
+    settle[b].attach_us(settled[b], DEBOUNCE_US);
+}
+
+static void button_settled(int b)
+{
+    settling[b] = 0;
+    button_changed(b);
+}
+
+static void button_edge(int b)
+{
+    if (!settling[b]) button_changed(b);
+}
+
+static void edge1() { button_edge(0); }
+static void edge2() { button_edge(1); }
+static void edge3() { button_edge(2); }
+static void (* const edges[BUTTONS])() = { edge1, edge2, edge3 };
+
+int read_button_event(ButtonEvent* event)
+{
+    if (tail == head) return 0;
+    *event = events[tail % BUTTON_EVENTS];
+    tail = tail + 1;
+    return 1;
+}
+
+/**
+ * Accelerometer sampling. A ticker counts the samples due, ACCEL_HZ a second,
+ * and the game loop reads all three axes in one I2C burst and filters them
+ * while it idles between frames (accel_update), so the bus time stays off the
+ * frames. The burst takes about 200 us even at 400 kHz and the I2C library
+ * only does blocking transfers, so it cannot run in an interrupt: the ticker
+ * shares the timer queue with the audio ticker, which must run every 125 us,
+ * and the button timeouts.
+ *
+ * The filtered tilt is written and read only by the game loop.
+ */
+static Ticker accel_ticker;
+static volatile int accel_due;          // Samples due since the last one taken
+static double tilt[3];                  // Filtered x, y, z in g
+
+static void accel_tick()
+{
+    accel_due = accel_due + 1;
+}
+
+static void sample_accel()
+{
+    static double filtered[3];
+    double raw[3];
+    if (acc.readXYZGravity(&raw[0], &raw[1], &raw[2])) return;
+
+    for (int i = 0; i < 3; i++) {
+        filtered[i] += (raw[i] - filtered[i]) * ACCEL_SMOOTHING;
+        tilt[i] = fabs(filtered[i]) < ACCEL_DEAD_ZONE ? 0.0 : filtered[i];
+    }
+}
+
+void accel_update()
+{
+    // Samples missed by a late call are skipped, not made up
+    if (!accel_due) return;
+    accel_due = 0;
+    sample_accel();
+}
+
 // Some hardware also needs to have functions called before it will set up
 // properly. Do that here.
 int hardware_init()
@@ -32,18 +154,44 @@ int hardware_init()
     button1.mode(PullUp); 
     button2.mode(PullUp);
     button3.mode(PullUp);
+    for (int b = 0; b < BUTTONS; b++) {
+        down[b] = !buttons[b]->read();
+        buttons[b]->rise(edges[b]);
+        buttons[b]->fall(edges[b]);
+    }
+
+    // Start sampling the accelerometer
+    sample_accel();
+    accel_ticker.attach_us(accel_tick, ACCEL_PERIOD_US);
+
+    // Quiet the speaker until something plays
+    audio_init();
     
     return ERROR_NONE;
 }
 
 GameInputs read_inputs() 
 {
+    PROFILE_SCOPE(PROFILE_READ_INPUTS);
     GameInputs in;
-    in.b1 = button1;
-    in.b2 = button2;
-    in.b3 = button3;
-    acc.readXGravity(&in.ax);
-    acc.readYGravity(&in.ay);
-    acc.readZGravity(&in.az);
+
+    // A press counts even if the button was released again before this read
+    int pressed[BUTTONS] = { 0, 0, 0 };
+    ButtonEvent event;
+    while (read_button_event(&event)) {
+        if (event.pressed) pressed[event.button] = 1;
+    }
+    in.b1_pressed = pressed[0];
+    in.b2_pressed = pressed[1];
+    in.b3_pressed = pressed[2];
+    in.b1 = !(down[0] || pressed[0]);
+    in.b2 = !(down[1] || pressed[1]);
+    in.b3 = !(down[2] || pressed[2]);
+
+    // A loop with no idle time still gets a sample now and then
+    if (accel_due >= ACCEL_MAX_MISSED) accel_update();
+    in.ax = tilt[0];
+    in.ay = tilt[1];
+    in.az = tilt[2];
     return in;
 }
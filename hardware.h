@@ -6,10 +6,48 @@
  * If additional hardware is added, new elements should be added to this struct.
  */
 struct GameInputs {
-    int b1, b2, b3;     // Button presses
+    int b1, b2, b3;     // Button presses: 0 while down or if pressed since the last read
+    int b1_pressed, b2_pressed, b3_pressed; // 1 if pressed since the last read
     double ax, ay, az;  // Accelerometer readings
 };
 
+/**
+ * A debounced button press or release, recorded by the button interrupts.
+ */
+struct ButtonEvent {
+    int button;             // 0, 1 or 2 for button1..3
+    int pressed;            // 1 for a press, 0 for a release
+    unsigned int time_us;   // us_ticker_read() when it happened
+};
+
+/**
+ * Button events queued between two reads. Events that do not fit are
+ * dropped.
+ */
+#define BUTTON_EVENTS 16
+
+/**
+ * How long a button must stay put after it changes before another change
+ * counts. Contacts bounce for a few milliseconds.
+ */
+#define DEBOUNCE_US 20000
+
+/**
+ * Accelerometer sampling rate, and its filter: each sample moves the reading
+ * ACCEL_SMOOTHING of the way toward it (1 for no smoothing), and tilts
+ * smaller than ACCEL_DEAD_ZONE (in g) read as level.
+ */
+#define ACCEL_HZ 50
+#define ACCEL_PERIOD_US (1000000 / ACCEL_HZ)
+#define ACCEL_SMOOTHING 0.5
+#define ACCEL_DEAD_ZONE 0.1
+
+/**
+ * Samples that may be missed in a row before read_inputs takes one itself
+ * rather than waiting for the game loop to idle.
+ */
+#define ACCEL_MAX_MISSED 5
+
 /**
  * Initialize all the hardware.
  */
@@ -23,4 +61,18 @@ int hardware_init();
  */
 GameInputs read_inputs();
 
+/**
+ * Read and filter the accelerometer if a sample is due. The reading is a
+ * blocking I2C transfer, so call it where the game loop idles, at least every
+ * ACCEL_PERIOD_US to keep the full rate. read_inputs calls it itself once
+ * ACCEL_MAX_MISSED samples have been missed.
+ */
+void accel_update();
+
+/**
+ * Take the oldest button event not yet read. Returns 1 and fills *event, or
+ * 0 if there is none. read_inputs drains the events, so use one or the other.
+ */
+int read_button_event(ButtonEvent* event);
+
 #endif // HARDWARE_H
\ No newline at end of file
@@ -54,6 +54,7 @@ Naming conventions in this file:
 * correctness, but it is better than nothing!
 ***************************************************************************/
 #include "hash_table.h"
+#include "pool.h"
 
 
 /****************************************************************************
@@ -64,6 +65,12 @@ Naming conventions in this file:
 ***************************************************************************/
 #include <stdlib.h>   // For malloc and free
 #include <stdio.h>    // For printf
+#include <string.h>   // For memcpy and memset
+#include <stdint.h>   // For uint64_t
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // For the 16-wide control group compare
+#endif
 
 
 /****************************************************************************
@@ -73,6 +80,18 @@ Naming conventions in this file:
 * the are forward declared in hash_table.h, the type names are
 * available everywhere and user code can hold pointers to these structs.
 ***************************************************************************/
+/**
+ * A single slot of the open addressing backend. Slots are stored back to back
+ * in one array, so there is no per-item allocation and no next pointer.
+ */
+typedef struct {
+  /** The key stored in this slot (only meaningful if the slot is full) */
+  unsigned int key;
+
+  /** The value associated with the key */
+  void* value;
+} OpenSlot;
+
 /**
  * This structure represents an a hash table.
  * Use "HashTable" instead when you are creating a new variable. [See top comments]
@@ -87,6 +106,51 @@ struct _HashTable {
 
   /** The number of buckets in the hash table */
   unsigned int num_buckets;
+
+  /** While the chained table is being resized, the bucket array that is
+      still being drained into buckets (NULL when no resize is running) */
+  HashTableEntry** old_buckets;
+
+  /** The number of buckets in old_buckets */
+  unsigned int old_num_buckets;
+
+  /** The next old bucket to migrate; every old bucket below it is empty */
+  unsigned int migrate_pos;
+
+  /** Grow when items exceed this percentage of the bucket count (0 = never) */
+  unsigned int grow_percent;
+
+  /** Shrink when items drop below this percentage of the bucket count (0 = never) */
+  unsigned int shrink_percent;
+
+  /** The bucket count the table was created with; it never shrinks below it */
+  unsigned int min_buckets;
+
+  /** HASH_CHAINED only: the slab pool the HashTableEntry nodes come from */
+  Pool* entry_pool;
+
+  /** The slab pool for values (see enableValuePool), or NULL if the values
+      are plain malloc'd blocks owned by the table */
+  Pool* value_pool;
+
+  /** Which backend this table uses: HASH_CHAINED or HASH_OPEN */
+  int backend;
+
+  /** HASH_OPEN only: one control byte per slot (CTRL_EMPTY, CTRL_DELETED,
+      or the low 7 bits of the hash of the key stored in the slot) */
+  unsigned char* ctrl;
+
+  /** HASH_OPEN only: the flat array of key/value slots */
+  OpenSlot* slots;
+
+  /** HASH_OPEN only: the number of slots (a power of two, at least one group) */
+  unsigned int num_slots;
+
+  /** The number of live items in the table */
+  unsigned int num_items;
+
+  /** HASH_OPEN only: the number of slots holding a tombstone */
+  unsigned int num_deleted;
 };
 
 /**
@@ -108,6 +172,14 @@ struct _HashTableEntry {
 };
 
 
+/** Default grow threshold: resize once there is more than one item per bucket */
+#define DEFAULT_GROW_PERCENT 100
+
+/** How many HashTableEntry nodes / values each pool slab holds */
+#define ENTRY_SLAB_ITEMS 32
+#define VALUE_SLAB_ITEMS 32
+
+
 /****************************************************************************
 * Private Functions
 *
@@ -117,17 +189,20 @@ struct _HashTableEntry {
 /**
 * createHashTableEntry
 *
-* Helper function that creates a hash table entry by allocating memory for it on
-* the heap. It initializes the entry with key and value, initialize pointer to
-* the next entry as NULL, and return the pointer to this hash table entry.
+* Helper function that creates a hash table entry by taking one from the
+* table's entry pool. It initializes the entry with key and value, initialize
+* pointer to the next entry as NULL, and return the pointer to this hash table
+* entry.
 *
+* @param hashTable The pointer to the hash table.
 * @param key The key corresponds to the hash table entry
 * @param value The value stored in the hash table entry
-* @return The pointer to the hash table entry
+* @return The pointer to the hash table entry, or NULL if out of memory
 */
-static HashTableEntry* createHashTableEntry(unsigned int key, void* value) {
-    // Allocate memory for a hash table entry on the heap
-    HashTableEntry* newTableEntry = (HashTableEntry*)malloc(sizeof(HashTableEntry));
+static HashTableEntry* createHashTableEntry(HashTable* hashTable, unsigned int key, void* value) {
+    // Take memory for a hash table entry from the pool
+    HashTableEntry* newTableEntry = (HashTableEntry*)poolAlloc(hashTable->entry_pool);
+    if (!newTableEntry) return NULL;
 
     // Initialize the entry with key and value
     newTableEntry->key = key;
@@ -146,11 +221,12 @@ static HashTableEntry* createHashTableEntry(unsigned int key, void* value) {
 *
 * @param hashTable The pointer to the hash table.
 * @param key The key corresponds to the hash table entry
+* @param hash The hash of key, computed once by the caller
 * @return The pointer to the hash table entry, or NULL if key does not exist
 */
-static HashTableEntry* findItem(HashTable* hashTable, unsigned int key) {
+static HashTableEntry* findItem(HashTable* hashTable, unsigned int key, unsigned int hash) {
     // Create a pointer to the head of the list
-    HashTableEntry* currTableEntry = hashTable->buckets[hashTable->hash(key)];
+    HashTableEntry* currTableEntry = hashTable->buckets[hash % hashTable->num_buckets];
 
     // Traverse the list until hit NULL
     while (currTableEntry) {
@@ -161,10 +237,396 @@ static HashTableEntry* findItem(HashTable* hashTable, unsigned int key) {
         currTableEntry = currTableEntry->next;
     }
 
+    // During a resize the key may still sit in a bucket not yet migrated
+    if (hashTable->old_buckets) {
+        currTableEntry = hashTable->old_buckets[hash % hashTable->old_num_buckets];
+        while (currTableEntry) {
+            if (currTableEntry->key == key) return currTableEntry;
+            currTableEntry = currTableEntry->next;
+        }
+    }
+
     // If the key DNE...
     return NULL;
 }
 
+/**
+* unlinkItem
+*
+* Helper function that unlinks the entry holding key from the list starting at
+* *head and returns it, or returns NULL if the key is not on that list.
+*
+* @param head The pointer to the head pointer of the bucket's list
+* @param key The key corresponds to the hash table entry
+* @return The unlinked hash table entry, or NULL if key does not exist
+*/
+static HashTableEntry* unlinkItem(HashTableEntry** head, unsigned int key) {
+    // Walk the "next" pointers so the head needs no special case
+    while (*head) {
+        if ((*head)->key == key) {
+            HashTableEntry* found = *head;
+            *head = found->next;
+            return found;
+        }
+        head = &(*head)->next;
+    }
+    return NULL;
+}
+
+/****************************************************************************
+* Incremental Resizing (chained backend)
+*
+* When the load factor (items per bucket) crosses grow_percent or
+* shrink_percent, the chained table allocates a new bucket array and keeps the
+* old one around in old_buckets. Every following operation moves a few old
+* buckets over (REHASH_STEP), so the cost of a resize is spread out instead of
+* landing on a single insertItem. Lookups check both arrays until the old one
+* is drained. This is why the hash function result is reduced modulo the
+* current bucket count inside the table rather than by the hash function.
+***************************************************************************/
+#define REHASH_STEP 4
+
+/**
+* rehashStep
+*
+* Helper function that migrates up to REHASH_STEP buckets from the old array to
+* the new one, and frees the old array once it is empty.
+*/
+static void rehashStep(HashTable* hashTable) {
+    for (int n = 0; n < REHASH_STEP && hashTable->old_buckets; n++) {
+        HashTableEntry* currTableEntry = hashTable->old_buckets[hashTable->migrate_pos];
+        while (currTableEntry) {
+            HashTableEntry* next = currTableEntry->next;
+            unsigned int i = hashTable->hash(currTableEntry->key) % hashTable->num_buckets;
+            currTableEntry->next = hashTable->buckets[i];
+            hashTable->buckets[i] = currTableEntry;
+            currTableEntry = next;
+        }
+        hashTable->old_buckets[hashTable->migrate_pos] = NULL;
+
+        // Done with the last old bucket: drop the old array
+        if (++hashTable->migrate_pos == hashTable->old_num_buckets) {
+            free(hashTable->old_buckets);
+            hashTable->old_buckets = NULL;
+            hashTable->old_num_buckets = 0;
+        }
+    }
+}
+
+/**
+* startRehash
+*
+* Helper function that begins moving the table to numBuckets buckets. A resize
+* that is still running is finished first.
+*/
+static void startRehash(HashTable* hashTable, unsigned int numBuckets) {
+    HashTableEntry** newBuckets = (HashTableEntry**)malloc(numBuckets*sizeof(HashTableEntry*));
+    // Out of memory: keep the current size, the table still works (just slower)
+    if (!newBuckets) return;
+
+    while (hashTable->old_buckets) rehashStep(hashTable);
+    for (unsigned int i = 0; i < numBuckets; i++) newBuckets[i] = NULL;
+
+    hashTable->old_buckets = hashTable->buckets;
+    hashTable->old_num_buckets = hashTable->num_buckets;
+    hashTable->migrate_pos = 0;
+    hashTable->buckets = newBuckets;
+    hashTable->num_buckets = numBuckets;
+}
+
+/**
+* checkLoad
+*
+* Helper function that starts a resize if the load factor is out of the
+* configured range, and otherwise makes progress on the running one.
+*/
+static void checkLoad(HashTable* hashTable) {
+    if (hashTable->old_buckets) {
+        rehashStep(hashTable);
+        return;
+    }
+
+    unsigned int items = hashTable->num_items;
+    unsigned int buckets = hashTable->num_buckets;
+    if (hashTable->grow_percent && items * 100 > buckets * hashTable->grow_percent) {
+        startRehash(hashTable, buckets * 2);
+    } else if (hashTable->shrink_percent && buckets / 2 >= hashTable->min_buckets
+               && items * 100 < buckets * hashTable->shrink_percent) {
+        startRehash(hashTable, buckets / 2);
+    }
+}
+
+/****************************************************************************
+* Open Addressing Backend
+*
+* The HASH_OPEN backend stores slots in one array, split into groups of
+* GROUP_WIDTH consecutive slots. Each slot has a control byte:
+*   - CTRL_EMPTY    the slot has never held an item since the last rehash
+*   - CTRL_DELETED  a tombstone left behind by removeItem
+*   - 0x00..0x7F    the slot is full; the byte is H2, the low 7 bits of the hash
+*
+* A lookup picks a starting group from H1 (the rest of the hash), compares H2
+* against every control byte of the group at once, and only looks at the
+* slots whose byte matched. If the group holds an empty slot the key cannot be
+* further along, so the probe stops; otherwise it moves to the next group
+* (triangular steps, which visit every group when their count is a power of 2).
+***************************************************************************/
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xFE
+
+#if defined(__SSE2__)
+// 16 control bytes per group, compared with one SSE2 instruction.
+// Bit i of a GroupMask is set when slot i of the group matched.
+#define GROUP_WIDTH 16
+typedef unsigned int GroupMask;
+
+static GroupMask groupMatch(const unsigned char* group, unsigned char tag) {
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (GroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)tag)));
+}
+
+static GroupMask groupMatchEmpty(const unsigned char* group) {
+    return groupMatch(group, CTRL_EMPTY);
+}
+
+static GroupMask groupMatchFree(const unsigned char* group) {
+    // Full slots have the top bit clear, empty and deleted ones have it set
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (GroupMask)_mm_movemask_epi8(ctrl);
+}
+
+static unsigned int groupNextIndex(GroupMask* mask) {
+    unsigned int i = 0;
+    while (!(*mask & (1u << i))) i++;
+    *mask &= *mask - 1;
+    return i;
+}
+#else
+// 8 control bytes per group, packed in a 64-bit word and compared with plain
+// integer arithmetic (SWAR). Byte i of a GroupMask has its top bit set when
+// slot i of the group matched. The match can report a false positive just
+// above a real one, which is harmless since the keys get compared anyway.
+#define GROUP_WIDTH 8
+typedef uint64_t GroupMask;
+
+#define GROUP_LSBS 0x0101010101010101ULL
+#define GROUP_MSBS 0x8080808080808080ULL
+
+static uint64_t groupLoad(const unsigned char* group) {
+    uint64_t word;
+    memcpy(&word, group, sizeof(word)); // Little endian: slot 0 is byte 0
+    return word;
+}
+
+static GroupMask groupMatch(const unsigned char* group, unsigned char tag) {
+    uint64_t x = groupLoad(group) ^ (GROUP_LSBS * tag);
+    return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+static GroupMask groupMatchEmpty(const unsigned char* group) {
+    // EMPTY is the only tag with bit 7 set and bit 1 clear
+    uint64_t word = groupLoad(group);
+    return word & (~word << 6) & GROUP_MSBS;
+}
+
+static GroupMask groupMatchFree(const unsigned char* group) {
+    // Full slots have the top bit clear, empty and deleted ones have it set
+    return groupLoad(group) & GROUP_MSBS;
+}
+
+static unsigned int groupNextIndex(GroupMask* mask) {
+    unsigned int i = 0;
+    while (!(*mask & ((GroupMask)0x80 << (8 * i)))) i++;
+    *mask &= *mask - 1;
+    return i;
+}
+#endif
+
+/**
+* mixKey
+*
+* Helper function that spreads the bits of a key over the whole 32-bit hash
+* (the MurmurHash3 finalizer). The open backend needs every bit to be useful:
+* the low 7 bits become the control tag and the rest pick the group.
+*
+* @param key The key to hash
+* @return The mixed hash
+*/
+static unsigned int mixKey(unsigned int key) {
+    key ^= key >> 16;
+    key *= 0x85ebca6bu;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35u;
+    key ^= key >> 16;
+    return key;
+}
+
+/**
+* openMaxLoad
+*
+* Helper function that returns how many slots (items plus tombstones) may be
+* used before the table has to be rehashed: 7/8 of the slots.
+*/
+static unsigned int openMaxLoad(unsigned int numSlots) {
+    return numSlots - numSlots / 8;
+}
+
+/**
+* openAllocSlots
+*
+* Helper function that allocates numSlots empty slots for an open table.
+* Returns 0, or -1 if out of memory, in which case the table is unchanged.
+*/
+static int openAllocSlots(HashTable* hashTable, unsigned int numSlots) {
+    unsigned char* ctrl = (unsigned char*)malloc(numSlots);
+    OpenSlot* slots = (OpenSlot*)malloc(numSlots * sizeof(OpenSlot));
+    if (!ctrl || !slots) {
+        free(ctrl);
+        free(slots);
+        return -1;
+    }
+    memset(ctrl, CTRL_EMPTY, numSlots);
+    hashTable->ctrl = ctrl;
+    hashTable->slots = slots;
+    hashTable->num_slots = numSlots;
+    hashTable->num_items = 0;
+    hashTable->num_deleted = 0;
+    return 0;
+}
+
+/**
+* openFindFree
+*
+* Helper function that returns the first empty or deleted slot on the probe
+* sequence of hash. There always is one, since the table never fills up.
+*/
+static unsigned int openFindFree(HashTable* hashTable, unsigned int hash) {
+    unsigned int groupMask = hashTable->num_slots / GROUP_WIDTH - 1;
+    unsigned int group = (hash >> 7) & groupMask;
+    for (unsigned int step = 1; ; step++) {
+        unsigned int base = group * GROUP_WIDTH;
+        GroupMask freeSlots = groupMatchFree(hashTable->ctrl + base);
+        if (freeSlots) return base + groupNextIndex(&freeSlots);
+        group = (group + step) & groupMask;
+    }
+}
+
+/**
+* openFind
+*
+* Helper function that returns the index of the slot holding key, or -1 if the
+* key is not in the table.
+*/
+static int openFind(HashTable* hashTable, unsigned int key, unsigned int hash) {
+    unsigned int groupMask = hashTable->num_slots / GROUP_WIDTH - 1;
+    unsigned int group = (hash >> 7) & groupMask;
+    unsigned char tag = hash & 0x7F;
+    for (unsigned int step = 1; step <= groupMask + 1; step++) {
+        unsigned int base = group * GROUP_WIDTH;
+        const unsigned char* ctrl = hashTable->ctrl + base;
+
+        // Only look at the slots whose control tag matches
+        GroupMask match = groupMatch(ctrl, tag);
+        while (match) {
+            unsigned int i = base + groupNextIndex(&match);
+            if (hashTable->slots[i].key == key) return i;
+        }
+
+        // An empty slot ends every probe sequence that reaches this group
+        if (groupMatchEmpty(ctrl)) return -1;
+        group = (group + step) & groupMask;
+    }
+    return -1;
+}
+
+/**
+* openRehash
+*
+* Helper function that moves every live item into a fresh slot array of
+* numSlots slots. This also drops all tombstones. Returns 0, or -1 if out of
+* memory, in which case the table is unchanged.
+*/
+static int openRehash(HashTable* hashTable, unsigned int numSlots) {
+    unsigned char* oldCtrl = hashTable->ctrl;
+    OpenSlot* oldSlots = hashTable->slots;
+    unsigned int oldNumSlots = hashTable->num_slots;
+    unsigned int numItems = hashTable->num_items;
+    unsigned int numDeleted = hashTable->num_deleted;
+
+    if (openAllocSlots(hashTable, numSlots)) {
+        hashTable->num_items = numItems;
+        hashTable->num_deleted = numDeleted;
+        return -1;
+    }
+    for (unsigned int i = 0; i < oldNumSlots; i++) {
+        if (oldCtrl[i] & 0x80) continue; // Empty or deleted
+        unsigned int hash = mixKey(oldSlots[i].key);
+        unsigned int slot = openFindFree(hashTable, hash);
+        hashTable->ctrl[slot] = hash & 0x7F;
+        hashTable->slots[slot] = oldSlots[i];
+    }
+    hashTable->num_items = numItems;
+
+    free(oldCtrl);
+    free(oldSlots);
+    return 0;
+}
+
+static void** openFindOrInsert(HashTable* hashTable, unsigned int key, int* inserted) {
+    unsigned int hash = mixKey(key);
+    int found = openFind(hashTable, key, hash);
+    // If the key is in the table, hand back its slot
+    if (found >= 0) {
+        *inserted = 0;
+        return &hashTable->slots[found].value;
+    }
+
+    // Make room first if this insert would push the table over its max load.
+    // If most of the used slots are tombstones, a same-size rehash is enough.
+    // Out of memory: fail the insert like the chained backend does
+    if (hashTable->num_items + hashTable->num_deleted + 1 > openMaxLoad(hashTable->num_slots)) {
+        unsigned int numSlots = hashTable->num_slots;
+        if (hashTable->num_items + 1 > openMaxLoad(numSlots) / 2) numSlots *= 2;
+        if (openRehash(hashTable, numSlots)) return NULL;
+    }
+
+    unsigned int slot = openFindFree(hashTable, hash);
+    if (hashTable->ctrl[slot] == CTRL_DELETED) hashTable->num_deleted--;
+    hashTable->ctrl[slot] = hash & 0x7F;
+    hashTable->slots[slot].key = key;
+    hashTable->slots[slot].value = NULL;
+    hashTable->num_items++;
+    *inserted = 1;
+    return &hashTable->slots[slot].value;
+}
+
+static void* openRemoveItem(HashTable* hashTable, unsigned int key) {
+    int found = openFind(hashTable, key, mixKey(key));
+    if (found < 0) return NULL;
+
+    // If the slot's group still has an empty slot, no probe sequence ever went
+    // past this group, so the slot can go straight back to empty. Otherwise it
+    // has to become a tombstone to keep later items reachable.
+    const unsigned char* group = hashTable->ctrl + (found / GROUP_WIDTH) * GROUP_WIDTH;
+    if (groupMatchEmpty(group)) {
+        hashTable->ctrl[found] = CTRL_EMPTY;
+    } else {
+        hashTable->ctrl[found] = CTRL_DELETED;
+        hashTable->num_deleted++;
+    }
+    hashTable->num_items--;
+    return hashTable->slots[found].value;
+}
+
+static void openDestroy(HashTable* hashTable) {
+    // Pooled values are released in bulk by destroyHashTable
+    for (unsigned int i = 0; i < hashTable->num_slots && !hashTable->value_pool; i++) {
+        if (!(hashTable->ctrl[i] & 0x80)) free(hashTable->slots[i].value);
+    }
+    free(hashTable->ctrl);
+    free(hashTable->slots);
+}
+
 /****************************************************************************
 * Public Interface Functions
 *
@@ -183,11 +645,30 @@ HashTable* createHashTable(HashFunction hashFunction, unsigned int numBuckets) {
 
   // Allocate memory for the new HashTable struct on heap.
   HashTable* newTable = (HashTable*)malloc(sizeof(HashTable));
+  if (!newTable) return NULL;
 
   // Initialize the components of the new HashTable struct.
   newTable->hash = hashFunction;
   newTable->num_buckets = numBuckets;
   newTable->buckets = (HashTableEntry**)malloc(numBuckets*sizeof(HashTableEntry*));
+  if (!newTable->buckets) {
+    free(newTable);
+    return NULL;
+  }
+  newTable->old_buckets = NULL;
+  newTable->old_num_buckets = 0;
+  newTable->migrate_pos = 0;
+  newTable->grow_percent = DEFAULT_GROW_PERCENT;
+  newTable->shrink_percent = 0;
+  newTable->min_buckets = numBuckets;
+  newTable->entry_pool = createPool(sizeof(HashTableEntry), ENTRY_SLAB_ITEMS);
+  newTable->value_pool = NULL;
+  newTable->backend = HASH_CHAINED;
+  newTable->ctrl = NULL;
+  newTable->slots = NULL;
+  newTable->num_slots = 0;
+  newTable->num_items = 0;
+  newTable->num_deleted = 0;
 
   // As the new buckets contain indeterminant values, init each bucket as NULL.
   unsigned int i;
@@ -199,95 +680,227 @@ HashTable* createHashTable(HashFunction hashFunction, unsigned int numBuckets) {
   return newTable;
 }
 
+HashTable* createHashTableWithBackend(HashFunction hashFunction, unsigned int numBuckets, int backend) {
+  HashTable* newTable = createHashTable(hashFunction, numBuckets);
+  if (!newTable || backend != HASH_OPEN) return newTable;
+
+  // The open table has no buckets or entries; size the slot array instead.
+  // Round up to a power of two number of groups that keeps numBuckets items
+  // under max load.
+  free(newTable->buckets);
+  destroyPool(newTable->entry_pool);
+  newTable->entry_pool = NULL;
+  newTable->buckets = NULL;
+  newTable->num_buckets = 0;
+  newTable->backend = HASH_OPEN;
+
+  unsigned int numSlots = GROUP_WIDTH;
+  while (openMaxLoad(numSlots) < numBuckets) numSlots *= 2;
+  if (openAllocSlots(newTable, numSlots)) {
+    destroyHashTable(newTable);
+    return NULL;
+  }
+  return newTable;
+}
+
+void setHashTableLoadFactors(HashTable* hashTable, unsigned int growPercent, unsigned int shrinkPercent) {
+    // Shrinking at or above the grow threshold would make the table flap
+    if (growPercent && shrinkPercent * 2 >= growPercent) shrinkPercent = growPercent / 4;
+    hashTable->grow_percent = growPercent;
+    hashTable->shrink_percent = shrinkPercent;
+}
+
 void destroyHashTable(HashTable* hashTable) {
     HashTableEntry* currTableEntry;
-    HashTableEntry* temp;
 
-    for (int i = 0; i < hashTable->num_buckets; i++) {
-        // Initialize a pointer to the head of the list
-        currTableEntry = hashTable->buckets[i];
-        // Traverse the list until hit NULL
-        while (currTableEntry) {
-                // Save the pointer to the current entry at the dummy pointer
-            temp = currTableEntry; 
-            // Go to the next entry 
-            currTableEntry = currTableEntry->next; 
-            // Free the dummy
-            free(temp->value); 
-            free(temp); 
+    if (hashTable->backend == HASH_OPEN) {
+        openDestroy(hashTable);
+    } else if (!hashTable->value_pool) {
+        // Finish a running resize so every entry is in the current buckets
+        while (hashTable->old_buckets) rehashStep(hashTable);
+
+        // The values are separate heap blocks, so the lists have to be walked
+        // to free them. The entries themselves go with the entry pool below.
+        for (int i = 0; i < hashTable->num_buckets; i++) {
+            // Initialize a pointer to the head of the list
+            currTableEntry = hashTable->buckets[i];
+            // Traverse the list until hit NULL
+            while (currTableEntry) {
+                free(currTableEntry->value);
+                currTableEntry = currTableEntry->next;
+            }
         }
     }
+
+    // Release entries and pooled values in bulk, one free per slab
+    if (hashTable->entry_pool) destroyPool(hashTable->entry_pool);
+    if (hashTable->value_pool) destroyPool(hashTable->value_pool);
+
     // Free the hash table
+    free(hashTable->old_buckets);
     free(hashTable->buckets);
     free(hashTable);
 }
 
-void* insertItem(HashTable* hashTable, unsigned int key, void* value) {
+void enableValuePool(HashTable* hashTable, unsigned int valueSize) {
+    if (!hashTable->value_pool) hashTable->value_pool = createPool(valueSize, VALUE_SLAB_ITEMS);
+}
+
+void* allocItemValue(HashTable* hashTable) {
+    return poolAlloc(hashTable->value_pool);
+}
+
+void freeItemValue(HashTable* hashTable, void* value) {
+    if (!hashTable->value_pool) {
+        free(value);
+    } else if (value && poolOwns(hashTable->value_pool, value)) {
+        poolFree(hashTable->value_pool, value);
+    }
+    // Values from anywhere else are not owned by a pooled table
+}
+
+void** findOrInsert(HashTable* hashTable, unsigned int key, int* inserted) {
+    int dummy;
+    if (!inserted) inserted = &dummy;
+    if (hashTable->backend == HASH_OPEN) return openFindOrInsert(hashTable, key, inserted);
+
+    // Hash once; the same value finds the entry and picks the bucket to link into
+    unsigned int hash = hashTable->hash(key);
+
     // Use the findItem function to look up for the existing entry
-    HashTableEntry* currTableEntry = findItem(hashTable, key);
-    // If the key is in the list...
+    HashTableEntry* currTableEntry = findItem(hashTable, key, hash);
+    // If the key is in the list, hand back its value slot
     if (currTableEntry) {
-        // Save the current entry value at the dummy variable for return
-        void* temp = currTableEntry->value;
-        // Update the value at that entry
-        currTableEntry->value = value;
-        return temp;
+        *inserted = 0;
+        return &currTableEntry->value;
     }
 
     // If the key is NOT in the list, create the new hash table entry
-    currTableEntry = createHashTableEntry(key, value);
+    currTableEntry = createHashTableEntry(hashTable, key, NULL);
     // Check if DNE
     if (!currTableEntry) {
         return NULL; 
     }
-  // Otherwise, insert the etry
-  currTableEntry->next = hashTable->buckets[hashTable->hash(key)];
-  hashTable->buckets[hashTable->hash(key)] = currTableEntry; 
-  return NULL;
+  // Otherwise, insert the etry (new entries always go to the current buckets)
+  unsigned int i = hash % hashTable->num_buckets;
+  currTableEntry->next = hashTable->buckets[i];
+  hashTable->buckets[i] = currTableEntry; 
+  hashTable->num_items++;
+  // A resize relinks entries but never moves them, so the slot stays valid
+  checkLoad(hashTable);
+  *inserted = 1;
+  return &currTableEntry->value;
+}
+
+void* insertItem(HashTable* hashTable, unsigned int key, void* value) {
+    int inserted;
+    void** slot = findOrInsert(hashTable, key, &inserted);
+    if (!slot) return NULL; // Out of memory
+
+    // Save the current value for return (if any) and store the new one
+    void* temp = inserted ? NULL : *slot;
+    *slot = value;
+    return temp;
 }
 
 void* getItem(HashTable* hashTable, unsigned int key) {
-    // Use the findItem function to look up; return its value if found
-    if (findItem(hashTable, key)) {
-        return findItem(hashTable, key)->value;
+    if (hashTable->backend == HASH_OPEN) {
+        int found = openFind(hashTable, key, mixKey(key));
+        return (found >= 0) ? hashTable->slots[found].value : NULL;
     }
-    return NULL;
+
+    // Lookups help a running resize along too
+    if (hashTable->old_buckets) rehashStep(hashTable);
+
+    // Use the findItem function to look up; return its value if found
+    HashTableEntry* currTableEntry = findItem(hashTable, key, hashTable->hash(key));
+    return currTableEntry ? currTableEntry->value : NULL;
 }
 
 void* removeItem(HashTable* hashTable, unsigned int key) {
-    // Initialize a pointer to the head of the list
-  HashTableEntry* currTableEntry = hashTable->buckets[hashTable->hash(key)];
-
-  // If the key is at the head...
-  if (currTableEntry && currTableEntry->key == key) {
-    // Save the current value at the dummy variable for return
-    void* temp = currTableEntry->value;
-    // Go to the next entry 
-    hashTable->buckets[hashTable->hash(key)] = currTableEntry->next;
-    // Free the current entry
-    free(currTableEntry);
-    return temp;
-  }
+  if (hashTable->backend == HASH_OPEN) return openRemoveItem(hashTable, key);
 
-    // If the item is NOT at the head of the list...
-  while (currTableEntry && currTableEntry->next) {
-    if (currTableEntry->next->key == key) {
-        // Save the next value at the dummy variable for return
-      HashTableEntry* tempEntry = currTableEntry->next;
-      // Go to the next-next entry 
-      void* temp = tempEntry->value;
-      currTableEntry->next = currTableEntry->next->next;
-      // Free the next entry
-      free(tempEntry);
-      return temp;
-    }
-    // Go to the next entry
-    currTableEntry = currTableEntry->next;
+  unsigned int hash = hashTable->hash(key);
+
+  // Unlink the entry from its current bucket, or from the old bucket if a
+  // resize has not migrated it yet
+  HashTableEntry* currTableEntry = unlinkItem(&hashTable->buckets[hash % hashTable->num_buckets], key);
+  if (!currTableEntry && hashTable->old_buckets) {
+    currTableEntry = unlinkItem(&hashTable->old_buckets[hash % hashTable->old_num_buckets], key);
   }
-  return NULL;
+  if (!currTableEntry) return NULL;
+
+  // Save the value for return and give the entry back to the pool
+  void* temp = currTableEntry->value;
+  poolFree(hashTable->entry_pool, currTableEntry);
+  hashTable->num_items--;
+  checkLoad(hashTable);
+  return temp;
 }
 
 void deleteItem(HashTable* hashTable, unsigned int key) {
-    // Use the removeItem function to free the entry
-    free(removeItem(hashTable, key));
+    // Use the removeItem function to free the entry, then free the value
+    freeItemValue(hashTable, removeItem(hashTable, key));
+}
+
+void forEachItem(HashTable* hashTable, ItemVisitor visit, void* context) {
+    if (hashTable->backend == HASH_OPEN) {
+        for (unsigned int i = 0; i < hashTable->num_slots; i++) {
+            if (hashTable->ctrl[i] & 0x80) continue; // Empty or deleted
+            visit(hashTable->slots[i].key, hashTable->slots[i].value, context);
+        }
+        return;
+    }
+
+    // Entries still waiting in the old buckets are visited there
+    HashTableEntry** arrays[2] = { hashTable->buckets, hashTable->old_buckets };
+    unsigned int sizes[2] = { hashTable->num_buckets, hashTable->old_num_buckets };
+    for (int a = 0; a < 2; a++) {
+        unsigned int first = a ? hashTable->migrate_pos : 0;
+        for (unsigned int i = first; arrays[a] && i < sizes[a]; i++) {
+            for (HashTableEntry* e = arrays[a][i]; e; e = e->next) visit(e->key, e->value, context);
+        }
+    }
+}
+
+/**
+* countChain
+*
+* Helper function that adds one chain (or probe) of the given length to stats.
+*/
+static void countChain(HashTableStats* stats, unsigned int length) {
+    if (length > stats->max_chain) stats->max_chain = length;
+    stats->histogram[length < HASH_STATS_BINS ? length : HASH_STATS_BINS - 1]++;
+}
+
+void getHashTableStats(HashTable* hashTable, HashTableStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->num_items = hashTable->num_items;
+
+    if (hashTable->backend == HASH_OPEN) {
+        stats->num_buckets = hashTable->num_slots;
+        unsigned int groupMask = hashTable->num_slots / GROUP_WIDTH - 1;
+        for (unsigned int i = 0; i < hashTable->num_slots; i++) {
+            if (hashTable->ctrl[i] & 0x80) continue; // Empty or deleted
+            // Replay the probe sequence up to the group holding slot i
+            unsigned int group = (mixKey(hashTable->slots[i].key) >> 7) & groupMask;
+            unsigned int probes = 0;
+            while (group != i / GROUP_WIDTH) group = (group + ++probes) & groupMask;
+            countChain(stats, probes);
+        }
+        return;
+    }
+
+    stats->num_buckets = hashTable->num_buckets;
+    HashTableEntry** arrays[2] = { hashTable->buckets, hashTable->old_buckets };
+    unsigned int sizes[2] = { hashTable->num_buckets, hashTable->old_num_buckets };
+    for (int a = 0; a < 2; a++) {
+        // Old buckets below migrate_pos are already drained
+        unsigned int first = a ? hashTable->migrate_pos : 0;
+        for (unsigned int i = first; arrays[a] && i < sizes[a]; i++) {
+            unsigned int length = 0;
+            for (HashTableEntry* e = arrays[a][i]; e; e = e->next) length++;
+            countChain(stats, length);
+        }
+    }
 }
\ No newline at end of file
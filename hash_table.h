@@ -28,6 +28,9 @@
   * The name of the type is "HashFunction".
   */
 typedef unsigned int (*HashFunction)(unsigned int key);
+// The table reduces the result modulo its current number of buckets, so a hash
+// function may return any unsigned value. It should not reduce by a fixed
+// bucket count itself, or the table cannot spread items when it grows.
 
 /**
  * This defines a type that is a _HashTable struct. The definition for
@@ -57,10 +60,63 @@ typedef struct _HashTableEntry HashTableEntry;
  *
  * @param myHashFunc The pointer to the custom hash function.
  * @param numBuckets The number of buckets available in the hash table.
- * @return a pointer to the new hash table
+ * @return a pointer to the new hash table, or NULL if out of memory
  */
 HashTable* createHashTable(HashFunction myHashFunc, unsigned int numBuckets);
 
+/**
+ * Hash table backends, selected when the table is created.
+ *
+ * HASH_CHAINED is the classic table described above: an array of buckets,
+ * each holding a singly linked list of HashTableEntry nodes.
+ *
+ * HASH_OPEN keeps every key/value pair in one flat slot array (open
+ * addressing). Next to the slots lives an array of one-byte "control" tags,
+ * and lookups compare a whole group of tags at once (SSE2 on hosts that have
+ * it, otherwise 8 tags packed in a 64-bit word), so a probe usually touches
+ * one or two cache lines and never chases a pointer.
+ */
+#define HASH_CHAINED 0
+#define HASH_OPEN    1
+
+/**
+ * createHashTableWithBackend
+ *
+ * Same as createHashTable, but lets the caller pick the backend. For
+ * HASH_CHAINED this is identical to createHashTable. For HASH_OPEN the table
+ * starts with room for at least numBuckets items and grows on its own when it
+ * gets too full; since every slot needs a well spread hash, the open backend
+ * mixes the key internally and myHashFunc is only kept for the chained one.
+ *
+ * @param myHashFunc The pointer to the custom hash function.
+ * @param numBuckets The number of buckets (or initial item capacity).
+ * @param backend HASH_CHAINED or HASH_OPEN.
+ * @return a pointer to the new hash table, or NULL if out of memory
+ */
+HashTable* createHashTableWithBackend(HashFunction myHashFunc, unsigned int numBuckets, int backend);
+
+/**
+ * setHashTableLoadFactors
+ *
+ * Configure when a chained table resizes. The load factor is the number of
+ * items per bucket, given here in percent. When an insert pushes it above
+ * growPercent the bucket array doubles; when a removal drops it below
+ * shrinkPercent the bucket array halves (never below the size the table was
+ * created with). The items are moved a few buckets at a time by the following
+ * operations, so no single call pays for the whole resize.
+ *
+ * New tables grow at 100% and never shrink. The open backend manages its own
+ * size and ignores these settings.
+ *
+ * A shrink threshold of half the grow threshold or more would make the table
+ * resize back and forth around one size, so it is lowered to growPercent/4.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param growPercent Grow threshold in percent, or 0 to never grow.
+ * @param shrinkPercent Shrink threshold in percent, or 0 to never shrink.
+ */
+void setHashTableLoadFactors(HashTable* myHashTable, unsigned int growPercent, unsigned int shrinkPercent);
+
 /**
  * destroyHashTable
  *
@@ -68,13 +124,54 @@ HashTable* createHashTable(HashFunction myHashFunc, unsigned int numBuckets);
  * list, the values stored on the linked list, the buckets, and the hashtable
  * itself are freed from the heap. In other words, free all the allocated memory
  * on heap that is associated with heap, including the values that users store in
- * the hash table.
+ * the hash table. Entries (and pooled values) live in slab pools, so they are
+ * released a whole slab at a time.
  *
  * @param myHashTable The pointer to the hash table.
  *
  */
 void destroyHashTable(HashTable* myHashTable);
 
+/**
+ * enableValuePool
+ *
+ * Let the table allocate the values stored in it from a slab pool of
+ * valueSize-byte blocks (see allocItemValue). Call this before inserting.
+ *
+ * Once enabled, the table only ever frees values that came from its pool:
+ * destroyHashTable releases them all at once without walking the table, and
+ * freeItemValue/deleteItem leave any other pointer alone (see poolOwns), so
+ * a pooled table can also hold pointers to values it does not own, such as
+ * shared static data; whoever owns those frees them.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param valueSize The size in bytes of every value allocated by the table.
+ */
+void enableValuePool(HashTable* myHashTable, unsigned int valueSize);
+
+/**
+ * allocItemValue
+ *
+ * Allocate one value from the table's pool (enableValuePool must have been
+ * called). The contents are not initialized.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @return the new value, or NULL if out of memory
+ */
+void* allocItemValue(HashTable* myHashTable);
+
+/**
+ * freeItemValue
+ *
+ * Free a value the way the table would: back to the pool for pooled tables
+ * (ignoring values not from the pool), or with free() otherwise. Use this for
+ * the old value returned by insertItem or removeItem.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param value The value to free (may be NULL).
+ */
+void freeItemValue(HashTable* myHashTable, void* value);
+
 /**
  * insertItem
  *
@@ -88,6 +185,26 @@ void destroyHashTable(HashTable* myHashTable);
  */
 void* insertItem(HashTable* myHashTable, unsigned int key, void* value);
 
+/**
+ * findOrInsert
+ *
+ * Find the entry for key, adding one with a NULL value if there is none, and
+ * return a reference to its value slot. The caller reads the old value and
+ * stores the new one through the slot, so replacing (and freeing) an item
+ * takes one hash and one traversal instead of a removeItem and an insertItem.
+ *
+ * A new entry must be given a non-NULL value before the next table call,
+ * since getItem cannot tell a NULL value from a missing key. The slot is only
+ * valid until the next insertion or removal.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param key The key to look up or add.
+ * @param inserted Set to 1 if the entry was added, 0 if it existed (may be NULL).
+ * @return the value slot, or NULL if out of memory (both backends; the table
+ *         is left as it was)
+ */
+void** findOrInsert(HashTable* myHashTable, unsigned int key, int* inserted);
+
 /**
  * getItem
  *
@@ -124,4 +241,52 @@ void* removeItem(HashTable* myHashTable, unsigned int key);
  */
 void deleteItem(HashTable* myHashTable, unsigned int key);
 
+/**
+ * A function called by forEachItem for every item, with the context pointer
+ * given to forEachItem.
+ */
+typedef void (*ItemVisitor)(unsigned int key, void* value, void* context);
+
+/**
+ * forEachItem
+ *
+ * Call visit once for every item in the table, in no particular order. The
+ * visitor must not insert or remove items, but it may change or free what
+ * the values point to.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param visit The function to call.
+ * @param context Passed on to visit.
+ */
+void forEachItem(HashTable* myHashTable, ItemVisitor visit, void* context);
+
+/**
+ * Occupancy statistics of a table, filled in by getHashTableStats.
+ *
+ * For HASH_CHAINED, histogram[n] counts the buckets holding n entries and
+ * max_chain is the longest list. For HASH_OPEN, histogram[n] counts the items
+ * found in the n-th group of their probe sequence (0 = the home group) and
+ * max_chain is the longest probe in groups. The last bin also counts
+ * everything beyond it.
+ */
+#define HASH_STATS_BINS 8
+typedef struct {
+  unsigned int num_items;     // Live items
+  unsigned int num_buckets;   // Buckets, or slots for HASH_OPEN
+  unsigned int max_chain;
+  unsigned int histogram[HASH_STATS_BINS];
+} HashTableStats;
+
+/**
+ * getHashTableStats
+ *
+ * Measure how evenly the items are spread. This walks the whole table, so it
+ * is a diagnostic, not something to call every frame. During a resize the
+ * buckets still being drained are counted too.
+ *
+ * @param myHashTable The pointer to the hash table.
+ * @param stats Where to store the statistics.
+ */
+void getHashTableStats(HashTable* myHashTable, HashTableStats* stats);
+
 #endif
\ No newline at end of file
@@ -4,11 +4,15 @@
 #include "map.h"
 #include "graphics.h"
 #include "speech.h"
+#include "path.h"
+#include "entity.h"
+#include "timestep.h"
+#include "audio.h"
+#include "music.h"
+#include "profile.h"
 
 // Functions in this file
 int get_action (GameInputs inputs);
-void move_dragon();
-void move_goblin();
 int update_game (int action);
 void draw_game (int init);
 void init_main_map ();
@@ -43,24 +47,11 @@ struct {
 } Player;
 
 /**
- * Moving Dragon.
+ * Entity ids of the dungeon's dragon and goblin (see entity.h), -1 before the
+ * dungeon is loaded.
  */
-struct {
-    int x, y;
-    int px, py;
-    int dir;
-    int dead;
-} MobileDragon;
-
-/**
- * Moving Goblin.
- */
-struct {
-    int x, y;
-    int px, py;
-    int dir;
-    int dead;
-} MobileGoblin;
+static int dragon = -1;
+static int goblin = -1;
 
 /**
  * Given the game inputs, determine what kind of update needs to happen.
@@ -94,6 +85,7 @@ static int gameState = MENU_BUTTON;
 
 int get_action(GameInputs inputs)
 {   
+    PROFILE_SCOPE(PROFILE_GET_ACTION);
     switch(gameState) {
         case MENU_BUTTON:
             if (inputs.b1 == 0 && inputs.b2 == 1 && inputs.b3 == 1) {
@@ -106,11 +98,14 @@ int get_action(GameInputs inputs)
             }
             else return NO_ACTION;
         case GAME:
-            if(inputs.b2 == 0) { 
+            // B2 toggles omnipotent mode, once per press
+            if (inputs.b2_pressed) {
                 omnipotent = !omnipotent;
                 test_led = !test_led;
-                wait(1.0);
             }
+
+            // B3 shows or hides the frame times
+            if (inputs.b3_pressed) profile_overlay(!profile_overlay_on());
             
             // B1 is default action button
             if (inputs.b1 == 0) return ACTION_BUTTON;
@@ -127,67 +122,30 @@ int get_action(GameInputs inputs)
 }
 
 /**
- * Moves the moving DRAGON every time a player moves 2 blocks.
+ * Empty cells have no MapItem (NULL) and no type.
  */
-void move_dragon() {
-    MapItem* east = get_east(MobileDragon.x, MobileDragon.y);
-    MapItem* west = get_west(MobileDragon.x, MobileDragon.y);
-    switch(MobileDragon.dir) {
-        case 0:     // RIGHT
-            if (east->walkable == 0) {
-                MobileDragon.dir = 1;  // change to left
-            }
-            else {
-                map_erase(MobileDragon.x, MobileDragon.y);
-                MobileDragon.x++;
-                add_dragon(MobileDragon.x, MobileDragon.y);
-            }
-            break;
-        case 1:     // LEFT
-            if (west->walkable == 0) {
-                MobileDragon.dir = 0;  // change to right
-            }
-            else {
-                map_erase(MobileDragon.x, MobileDragon.y);
-                MobileDragon.x--;
-                add_dragon(MobileDragon.x, MobileDragon.y);
-            }
-            break;
-        default: 
-            break;
-    }
-}
+static int type_of(MapItem* item) { return item ? item->type : -1; }
 
 /**
- * Moves the moving GOBLIN every time a player moves 2 blocks.
+ * How many cells the main loop lets the flow field's sweep (see path.h) visit
+ * per tick.
  */
-void move_goblin() {
-    MapItem* north = get_north(MobileGoblin.x, MobileGoblin.y);
-    MapItem* south = get_south(MobileGoblin.x, MobileGoblin.y);
-    switch(MobileGoblin.dir) {
-        case 0:     // UP
-            if (north->walkable == 0) {
-                MobileGoblin.dir = 1;  // change to down
-            }
-            else {
-                map_erase(MobileGoblin.x, MobileGoblin.y);
-                MobileGoblin.y--;
-                add_goblin(MobileGoblin.x, MobileGoblin.y);
-            }
-            break;
-        case 1:     // DOWN
-            if (south->walkable == 0) {
-                MobileGoblin.dir = 0;  // change to up
-            }
-            else {
-                map_erase(MobileGoblin.x, MobileGoblin.y);
-                MobileGoblin.y++;
-                add_goblin(MobileGoblin.x, MobileGoblin.y);
-            }
-            break;
-        default: 
-            break;
-    }
+#define FLOW_BUDGET 128
+
+/**
+ * How often the main loop prints the frame counters (see timestep.h): once a
+ * minute of game time.
+ */
+#define STATS_TICKS (60 * TICK_HZ)
+
+/**
+ * Type of what stands at (x,y): the entity there, if any, or the map item.
+ */
+static int type_at(int x, int y)
+{
+    int id = entity_at(x, y);
+    if (id >= 0) return get_prototype(entity_kind(id))->type;
+    return type_of(get_here(x, y));
 }
 
 /**
@@ -207,16 +165,12 @@ void move_goblin() {
 
 int update_game(int action)
 {
+    PROFILE_SCOPE(PROFILE_UPDATE_GAME);
+
     // Save player previous location before updating
     Player.px = Player.x;
     Player.py = Player.y;
     Player.phealth = Player.health;
-
-    MobileDragon.px = MobileDragon.x;
-    MobileDragon.py = MobileDragon.y;
-    
-    MobileGoblin.px = MobileGoblin.x;
-    MobileGoblin.py = MobileGoblin.y;
     
     
     // Do different things based on the each action.
@@ -232,37 +186,25 @@ int update_game(int action)
         case GO_UP:
             if (gameState == MENU_BUTTON) return NO_ACTION;
             if (mode_select) {  // only for ADVANCED
-                if ((Player.x + Player.y)%2) {
-                    if (!MobileDragon.dead) move_dragon();
-                    if (!MobileGoblin.dead) move_goblin();
-                }
+                if ((Player.x + Player.y)%2) entities_update(Player.x, Player.y);
             }
             return go_up();
         case GO_LEFT:
             if (gameState == MENU_BUTTON) return NO_ACTION;
             if (mode_select) {
-                if ((Player.x + Player.y)%2) {
-                    if (!MobileDragon.dead) move_dragon();
-                    if (!MobileGoblin.dead) move_goblin();
-                }
+                if ((Player.x + Player.y)%2) entities_update(Player.x, Player.y);
             }
             return go_left();
         case GO_DOWN:
             if (gameState == MENU_BUTTON) return NO_ACTION;
             if (mode_select) {
-                if ((Player.x + Player.y)%2) {
-                    if (!MobileDragon.dead) move_dragon();
-                    if (!MobileGoblin.dead) move_goblin();
-                }
+                if ((Player.x + Player.y)%2) entities_update(Player.x, Player.y);
             }
             return go_down();
         case GO_RIGHT:
             if (gameState == MENU_BUTTON) return NO_ACTION;
             if (mode_select) {
-                if ((Player.x + Player.y)%2) {
-                    if (!MobileDragon.dead) move_dragon();
-                    if (!MobileGoblin.dead) move_goblin();
-                }
+                if ((Player.x + Player.y)%2) entities_update(Player.x, Player.y);
             }
             return go_right();
         case ACTION_BUTTON:
@@ -280,86 +222,156 @@ int update_game(int action)
  * Entry point for frame drawing. This should be called once per iteration of
  * the game loop. This draws all tiles on the screen, followed by the status 
  * bars. Unless init is nonzero, this function will optimize drawing by only 
- * drawing tiles that have changed from the previous frame.
+ * drawing tiles that have changed from the previous frame: either the screen
+ * cell now shows a different item or entity (the view scrolled), or the map
+ * cell it shows, now or last frame, was marked dirty (see map_mark_dirty).
+ * Rows under a speech bubble are left alone and redrawn when it closes.
+ */
+#define VIEW_W 11    // Visible map tiles across
+#define VIEW_H 9     // Visible map tiles down
+#define SPAN_GAP 2   // Unchanged tiles that end a burst (fewer are resent)
+
+static void draw_player_tile(int u, int v)
+{
+    draw_player(u, v, Player.has_key);
+}
+
+/**
+ * How the entity at (x,y) is drawn, or NULL if there is none.
  */
+static DrawFunc entity_draw_at(int x, int y)
+{
+    int id = entity_at(x, y);
+    return id >= 0 ? get_prototype(entity_kind(id))->draw : NULL;
+}
+
+/**
+ * Send one row of tiles. Runs of changed tiles are composed off-screen and
+ * sent with a single BLIT each; a gap of fewer than SPAN_GAP unchanged tiles
+ * is cheaper to resend than to start a new burst, so it is drawn into the
+ * run with its current look. over[] holds an entity drawn on top of the tile.
+ */
+static void draw_tile_row(int v, DrawFunc* look, DrawFunc* over, int* changed)
+{
+    int c = 0;
+    while (c < VIEW_W)
+    {
+        if (!changed[c]) { c++; continue; }
+
+        // Extend the run until SPAN_GAP unchanged tiles in a row
+        int first = c, last = c;
+        for (int k = c + 1; k < VIEW_W && k - last <= SPAN_GAP; k++)
+            if (changed[k]) last = k;
+
+        fb_begin(first*11 + 3, v, (last - first + 1)*11, 11);
+        for (int k = first; k <= last; k++)
+        {
+            int u = k*11 + 3;
+            if (look[k]) look[k](u, v);
+            if (over[k]) over[k](u, v);
+        }
+        fb_end();
+        c = last + 1;
+    }
+}
+
 void draw_game(int init)
 {
+    PROFILE_SCOPE(PROFILE_DRAW_GAME);
+
     // Draw game border first
     if(init) draw_border();
+
+    // Where the player was and how healthy on the last frame drawn. Several
+    // updates may run between two frames (see timestep.h), so Player.px/py
+    // only hold the step before the last one.
+    static int shown_x, shown_y, shown_health;
+
+    // Rows a speech bubble covered on the last frame, to be redrawn whole
+    // once it is gone
+    static int covered[VIEW_H];
+
+    // Fetch the visible window around the current and previous player
+    // position in one pass each, instead of a lookup per tile
+    static MapItem* curr_view[VIEW_W * VIEW_H];
+    static MapItem* prev_view[VIEW_W * VIEW_H];
+    map_region(Player.x - VIEW_W/2, Player.y - VIEW_H/2, VIEW_W, VIEW_H, curr_view);
+    map_region(shown_x - VIEW_W/2, shown_y - VIEW_H/2, VIEW_W, VIEW_H, prev_view);
     
-    // Iterate over all visible map tiles
-    for (int i = -5; i <= 5; i++) // Iterate over columns of tiles
+    // How far the view scrolled since the last frame
+    int dx = Player.x - shown_x;
+    int dy = Player.y - shown_y;
+
+    // Iterate over all visible map tiles, one row at a time
+    for (int j = -4; j <= 4; j++) // Iterate over rows of tiles
     {
-        for (int j = -4; j <= 4; j++) // Iterate over one column of tiles
+        int v = (j+4)*11 + 15;  // Screen row of this row of tiles
+        if (speech_covers(v, 11)) {
+            covered[j+4] = 1;
+            continue;
+        }
+        int uncovered = covered[j+4];
+        covered[j+4] = 0;
+
+        DrawFunc look[VIEW_W];  // What each tile shows this frame
+        DrawFunc over[VIEW_W];  // Entity drawn on top of the tile, if any
+        int changed[VIEW_W];    // Whether the tile must be sent again
+
+        for (int i = -5; i <= 5; i++) // Iterate over one row of tiles
         {
             // Here, we have a given (i,j)
             
             // Compute the current map (x,y) of this tile
             int x = i + Player.x;
             int y = j + Player.y;
+
+            // Index of this tile in the view buffers
+            int c = i + 5;
+            int cell = (j+4)*VIEW_W + c;
             
-            // Compute the previous map (px, py) of this tile
-            int px = i + Player.px;
-            int py = j + Player.py;
-                        
-            // Compute u,v coordinates for drawing
-            int u = (i+5)*11 + 3;
-            int v = (j+4)*11 + 15;
-            
-            // Figure out what to draw
-            DrawFunc draw = NULL;
-            if (init && i == 0 && j == 0) // Only draw the player on init
+            // Figure out what this tile looks like and whether it changed
+            MapItem* curr_item = curr_view[cell];
+            look[c] = NULL;
+            over[c] = NULL;
+            changed[c] = 0;
+            if (i == 0 && j == 0) // The player is only redrawn on init
             {
-                draw_player(u, v, Player.has_key);
-                continue;
+                look[c] = draw_player_tile;
+                changed[c] = init || uncovered;
             }
             else if (x >= 0 && y >= 0 && x < map_width() && y < map_height()) // Current (i,j) in the map
             {
-                MapItem* curr_item = get_here(x, y);
-                MapItem* prev_item = get_here(px, py);
-                if (init || curr_item != prev_item) // Only draw if they're different
-                {
-                    if (curr_item) // There's something here! Draw it
-                    {
-                        draw = curr_item->draw;
-                    }
-                    else // There used to be something, but now there isn't
-                    {
-                        draw = draw_nothing;
-                    }
-                }
-            }
-            else if (x == MobileDragon.x && y == MobileDragon.y) {
-                if(Player.px != Player.x || Player.py != Player.y || init == 2){
-                    MapItem* curr_item = get_here(x, y);
-                    draw = (curr_item)?curr_item->draw:draw_nothing;
-                    draw(u,v);
-                    draw_dragon(u, v);
-                }
-                continue;
-            }
-            else if (x == MobileGoblin.x && y == MobileGoblin.y) {
-                if(Player.px != Player.x || Player.py != Player.y || init == 2){
-                    MapItem* curr_item = get_here(x, y);
-                    draw = (curr_item)?curr_item->draw:draw_nothing;
-                    draw(u,v);
-                    draw_goblin(u, v);
-                }
-                continue;
+                // Only draw if they're different, or the map changed here.
+                // An entity that moved marked both its cells dirty, so one
+                // that stood still was in the previous cell last frame.
+                look[c] = (curr_item) ? curr_item->draw : draw_nothing;
+                over[c] = entity_draw_at(x, y);
+                changed[c] = init || uncovered || curr_item != prev_view[cell]
+                          || over[c] != entity_draw_at(x - dx, y - dy)
+                          || map_is_dirty(x, y) || map_is_dirty(x - dx, y - dy);
             }
-            else if (init) // If doing a full draw, but we're out of bounds, draw the walls.
+            else // Out of bounds shows the walls drawn on the last full draw
             {
-                draw = draw_wall;
+                look[c] = draw_wall;
+                changed[c] = init || uncovered;
             }
-
-            // Actually draw the tile
-            if (draw) draw(u, v);
         }
+
+        // Actually draw the changed tiles of this row
+        draw_tile_row(v, look, over, changed);
     }
 
+    // Everything that changed is on screen now
+    map_clear_dirty();
+
     // Draw status bars    
-    draw_upper_status(Player.x, Player.y, Player.px, Player.py);
-    if (mode_select) draw_lower_status(Player.health, Player.phealth);  // Only for ADVANCED mode
+    draw_upper_status(Player.x, Player.y, shown_x, shown_y);
+    if (mode_select) draw_lower_status(Player.health, shown_health);  // Only for ADVANCED mode
+    profile_draw_overlay(mode_select);
+
+    shown_x = Player.x;
+    shown_y = Player.y;
+    shown_health = Player.health;
 }
 
 // Dsiplays "Game Over" when the quest is completed
@@ -390,10 +402,19 @@ void game_over(int next_state)
     }
 }
 
+/**
+ * Sound effects (see audio.h): a low buzz for walking into something, and a
+ * rising chirp for picking something up.
+ */
+#define SOUND_VOLUME 128
+#define MUSIC_VOLUME 64
+static const Tone bump_sound[] = { {75, 50}, {0, 0} };
+static const Tone pickup_sound[] = { {880, 60}, {1320, 120}, {0, 0} };
+
 int action_button() 
 {
     // Interaction with WIZARD
-    if (get_north(Player.x, Player.y) -> type == WIZARD || get_south(Player.x, Player.y) -> type == WIZARD || get_east(Player.x, Player.y) -> type == WIZARD || get_west(Player.x, Player.y) -> type == WIZARD) {
+    if (type_of(get_north(Player.x, Player.y)) == WIZARD || type_of(get_south(Player.x, Player.y)) == WIZARD || type_of(get_east(Player.x, Player.y)) == WIZARD || type_of(get_west(Player.x, Player.y)) == WIZARD) {
     
         const char* line1 = "I have a job for you! You have to kill the dragon for a nice reward. Here's the laddar to the dungeon where it lives.\n";
 
@@ -413,7 +434,7 @@ int action_button()
     }
     
     // Interaction with LADDAR
-    if (get_north(Player.x, Player.y) -> type == LADDAR || get_south(Player.x, Player.y) -> type == LADDAR || get_east(Player.x, Player.y) -> type == LADDAR || get_west(Player.x, Player.y) -> type == LADDAR) {
+    if (type_of(get_north(Player.x, Player.y)) == LADDAR || type_of(get_south(Player.x, Player.y)) == LADDAR || type_of(get_east(Player.x, Player.y)) == LADDAR || type_of(get_west(Player.x, Player.y)) == LADDAR) {
         if (Player.spell && Player.exit) {
             speech("Now that the dragon is dead, the dungeon is sealed. Go talk to Merlin again.\n");
             return FULL_DRAW;
@@ -447,49 +468,52 @@ int action_button()
     }
     
     // Interaction with GOOD (Dragon) spell
-    if (get_north(Player.x, Player.y) -> type == SPELL || get_south(Player.x, Player.y) -> type == SPELL || get_east(Player.x, Player.y) -> type == SPELL || get_west(Player.x, Player.y) -> type == SPELL) {
+    if (type_of(get_north(Player.x, Player.y)) == SPELL || type_of(get_south(Player.x, Player.y)) == SPELL || type_of(get_east(Player.x, Player.y)) == SPELL || type_of(get_west(Player.x, Player.y)) == SPELL) {
         if (!mode_select) {     // BASELINE interaction
             speech("You cast the good spell! Now the dragon is dead. Go back to Merlin and talk to him again.\n");
             Player.spell = 1;
         }
         else if (mode_select) { // ADVANCED interaction
             speech("You cast the final spell! Now the dragon is (also) dead. Go back to Merlin and talk to him again.\n");
-            MobileDragon.dead = 1;
             map_erase(spell_cox, spell_coy);
-            map_erase(MobileDragon.x, MobileDragon.y);
-            add_grave(MobileDragon.x, MobileDragon.y);
+            if (entity_alive(dragon)) {
+                add_grave(entity_x(dragon), entity_y(dragon));
+                entity_damage(dragon, 255);
+            }
             Player.spell = 1;
         }
         return FULL_DRAW;
     }
 
     // Interaction with DARK (Goblin) spell
-    if (get_north(Player.x, Player.y) -> type == SPELL_DARK || get_south(Player.x, Player.y) -> type == SPELL_DARK || get_east(Player.x, Player.y) -> type == SPELL_DARK || get_west(Player.x, Player.y) -> type == SPELL_DARK) {
+    if (type_of(get_north(Player.x, Player.y)) == SPELL_DARK || type_of(get_south(Player.x, Player.y)) == SPELL_DARK || type_of(get_east(Player.x, Player.y)) == SPELL_DARK || type_of(get_west(Player.x, Player.y)) == SPELL_DARK) {
         if (!mode_select) {     // BASELINE interaction
             speech("This is the dark spell... You're gonna be cursed if you use it! Try the other one.\n");
         }
         else if (mode_select) { // ADVANCED interaction
             speech("You cast the spell! Now the goblin is dead. Go finish off the dragon!\n");
-            MobileGoblin.dead = 1;
             map_erase(spell_goblin_cox, spell_goblin_coy);
-            map_erase(MobileGoblin.x, MobileGoblin.y);
-            add_grave(MobileGoblin.x, MobileGoblin.y); 
+            if (entity_alive(goblin)) {
+                add_grave(entity_x(goblin), entity_y(goblin));
+                entity_damage(goblin, 255);
+            }
             add_elixir(elixir_cox, elixir_coy);     // Drop elixir
         }
         return FULL_DRAW;
     }
     
     // Interaction with KEY
-    if (get_north(Player.x, Player.y) -> type == KEY || get_south(Player.x, Player.y) -> type == KEY || get_east(Player.x, Player.y) -> type == KEY || get_west(Player.x, Player.y) -> type == KEY) {
+    if (type_of(get_north(Player.x, Player.y)) == KEY || type_of(get_south(Player.x, Player.y)) == KEY || type_of(get_east(Player.x, Player.y)) == KEY || type_of(get_west(Player.x, Player.y)) == KEY) {
         
         speech("You got a key. Now open the treasure chest and you'll be finally rewarded.\n");
 
         Player.has_key = true;
+        audio_play(pickup_sound, SOUND_VOLUME);
 
-        if      (get_north(Player.x, Player.y) -> type == KEY)  map_erase(Player.x, Player.y - 1);
-        else if (get_south(Player.x, Player.y) -> type == KEY)  map_erase(Player.x, Player.y + 1);
-        else if (get_east(Player.x, Player.y) -> type == KEY)   map_erase(Player.x + 1, Player.y);
-        else if (get_west(Player.x, Player.y) -> type == KEY)   map_erase(Player.x - 1, Player.y);
+        if      (type_of(get_north(Player.x, Player.y)) == KEY)  map_erase(Player.x, Player.y - 1);
+        else if (type_of(get_south(Player.x, Player.y)) == KEY)  map_erase(Player.x, Player.y + 1);
+        else if (type_of(get_east(Player.x, Player.y)) == KEY)   map_erase(Player.x + 1, Player.y);
+        else if (type_of(get_west(Player.x, Player.y)) == KEY)   map_erase(Player.x - 1, Player.y);
         
         add_chest(Player.x - 3, Player.y - 3);
         
@@ -497,26 +521,26 @@ int action_button()
     }
     
     // Interaction with CHEST
-    if (get_north(Player.x, Player.y) -> type == CHEST || get_south(Player.x, Player.y) -> type == CHEST || get_east(Player.x, Player.y) -> type == CHEST || get_west(Player.x, Player.y) -> type == CHEST) {
+    if (type_of(get_north(Player.x, Player.y)) == CHEST || type_of(get_south(Player.x, Player.y)) == CHEST || type_of(get_east(Player.x, Player.y)) == CHEST || type_of(get_west(Player.x, Player.y)) == CHEST) {
         if (Player.has_key) {
             speech("Congratulations! You're a hero and rich!\n");
-            game_over(WIN);
-            return FULL_DRAW;
+            return WIN;
         }
     }
     
     // Interaction with ELIXIR
-    if (get_north(Player.x, Player.y) -> type == ELIXIR || get_south(Player.x, Player.y) -> type == ELIXIR || get_east(Player.x, Player.y) -> type == ELIXIR || get_west(Player.x, Player.y) -> type == ELIXIR) {
+    if (type_of(get_north(Player.x, Player.y)) == ELIXIR || type_of(get_south(Player.x, Player.y)) == ELIXIR || type_of(get_east(Player.x, Player.y)) == ELIXIR || type_of(get_west(Player.x, Player.y)) == ELIXIR) {
         
         speech("This is Life Elixir. You're health is now boosted up.\n");
         
         Player.phealth = Player.health;
         Player.health++;
+        audio_play(pickup_sound, SOUND_VOLUME);
 
-        if      (get_north(Player.x, Player.y) -> type == ELIXIR)  map_erase(Player.x, Player.y - 1);
-        else if (get_south(Player.x, Player.y) -> type == ELIXIR)  map_erase(Player.x, Player.y + 1);
-        else if (get_east(Player.x, Player.y) -> type == ELIXIR)   map_erase(Player.x + 1, Player.y);
-        else if (get_west(Player.x, Player.y) -> type == ELIXIR)   map_erase(Player.x - 1, Player.y);
+        if      (type_of(get_north(Player.x, Player.y)) == ELIXIR)  map_erase(Player.x, Player.y - 1);
+        else if (type_of(get_south(Player.x, Player.y)) == ELIXIR)  map_erase(Player.x, Player.y + 1);
+        else if (type_of(get_east(Player.x, Player.y)) == ELIXIR)   map_erase(Player.x + 1, Player.y);
+        else if (type_of(get_west(Player.x, Player.y)) == ELIXIR)   map_erase(Player.x - 1, Player.y);
     
         
         return FULL_DRAW;
@@ -528,29 +552,28 @@ int action_button()
 
 int go_up()
 {
-    MapItem *next = get_north(Player.x, Player.y);
-    MapItem *here = get_here(Player.x, Player.y);
+    int blocked = map_blocked_neighbors(Player.x, Player.y) | entity_neighbors(Player.x, Player.y);
 
     if (omnipotent) {
+        // Walking through or out of a wall or mob redraws everything
+        int through = (blocked & BLOCKED_N) || map_blocked(Player.x, Player.y)
+                   || entity_at(Player.x, Player.y) >= 0;
         Player.y = Player.y - 1;
-        if (!(next->walkable) || !(here->walkable))
+        if (through)
             return FULL_DRAW;
 
         return NO_RESULT;
     }
 
-    if (next->walkable) {
+    if (!(blocked & BLOCKED_N)) {
         Player.y = Player.y - 1;
         return NO_RESULT;
     } 
     else {
-        speaker = 0.3;
-        speaker.period(1.0/75.0);
-        wait(0.05);
-        speaker = 0;
+        audio_play(bump_sound, SOUND_VOLUME);
     }
     
-    if (next->type == DANGER)
+    if (type_at(Player.x, Player.y - 1) == DANGER)
     {
         Player.phealth = Player.health;
         Player.health = Player.health - 1;
@@ -567,29 +590,28 @@ int go_up()
 
 int go_down()
 {
-    MapItem *next = get_south(Player.x, Player.y);
-    MapItem *here = get_here(Player.x, Player.y);
+    int blocked = map_blocked_neighbors(Player.x, Player.y) | entity_neighbors(Player.x, Player.y);
 
     if (omnipotent) {
+        // Walking through or out of a wall or mob redraws everything
+        int through = (blocked & BLOCKED_S) || map_blocked(Player.x, Player.y)
+                   || entity_at(Player.x, Player.y) >= 0;
         Player.y = Player.y + 1;
-        if (!(next->walkable) || !(here->walkable))
+        if (through)
             return FULL_DRAW;
 
         return NO_RESULT;
     }
 
-    if (next->walkable) {
+    if (!(blocked & BLOCKED_S)) {
         Player.y = Player.y + 1;
         return NO_RESULT;
     } 
     else {
-        speaker = 0.3;
-        speaker.period(1.0/75.0);
-        wait(0.05);
-        speaker = 0;
+        audio_play(bump_sound, SOUND_VOLUME);
     }
     
-    if (next->type == DANGER)
+    if (type_at(Player.x, Player.y + 1) == DANGER)
     {
         Player.phealth = Player.health;
         Player.health = Player.health - 1;
@@ -605,29 +627,28 @@ int go_down()
 
 int go_right()
 {
-    MapItem *next = get_east(Player.x, Player.y);
-    MapItem *here = get_here(Player.x, Player.y);
+    int blocked = map_blocked_neighbors(Player.x, Player.y) | entity_neighbors(Player.x, Player.y);
 
     if (omnipotent) {
+        // Walking through or out of a wall or mob redraws everything
+        int through = (blocked & BLOCKED_E) || map_blocked(Player.x, Player.y)
+                   || entity_at(Player.x, Player.y) >= 0;
         Player.x = Player.x + 1;
-        if (!(next->walkable) || !(here->walkable))
+        if (through)
             return FULL_DRAW;
 
         return NO_RESULT;
     }
 
-    if (next->walkable) {
+    if (!(blocked & BLOCKED_E)) {
         Player.x = Player.x + 1;
         return NO_RESULT;
     } 
     else {
-        speaker = 0.3;
-        speaker.period(1.0/75.0);
-        wait(0.05);
-        speaker = 0;
+        audio_play(bump_sound, SOUND_VOLUME);
     }
     
-    if (next->type == DANGER)
+    if (type_at(Player.x + 1, Player.y) == DANGER)
     {
         Player.phealth = Player.health;
         Player.health = Player.health - 1;
@@ -643,29 +664,28 @@ int go_right()
 
 int go_left() 
 {
-    MapItem *next = get_west(Player.x, Player.y);
-    MapItem *here = get_here(Player.x, Player.y);
+    int blocked = map_blocked_neighbors(Player.x, Player.y) | entity_neighbors(Player.x, Player.y);
 
     if (omnipotent) {
+        // Walking through or out of a wall or mob redraws everything
+        int through = (blocked & BLOCKED_W) || map_blocked(Player.x, Player.y)
+                   || entity_at(Player.x, Player.y) >= 0;
         Player.x = Player.x - 1;
-        if (!(next->walkable) || !(here->walkable))
+        if (through)
             return FULL_DRAW;
 
         return NO_RESULT;
     }
 
-    if (next->walkable) {
+    if (!(blocked & BLOCKED_W)) {
         Player.x = Player.x - 1;
         return NO_RESULT;
     } 
     else {
-        speaker = 0.3;
-        speaker.period(1.0/75.0);
-        wait(0.05);
-        speaker = 0;
+        audio_play(bump_sound, SOUND_VOLUME);
     }
     
-    if (next->type == DANGER)
+    if (type_at(Player.x - 1, Player.y) == DANGER)
     {
         Player.phealth = Player.health;
         Player.health = Player.health - 1;
@@ -686,8 +706,16 @@ int go_left()
  */
 void init_main_map()
 {
+    // A world file on the SD card replaces the built-in main map. It is
+    // streamed in chunks, so it can be far bigger than what fits in RAM.
+    if (map_stream_world(0, "main")) {
+        set_active_map(0);
+        add_npc_wizard(43, 39);
+        return;
+    }
+
     // "Random" plants
-    Map* map = set_active_map(0);
+    set_active_map(0);
     for(int i = map_width() + 3; i < map_area(); i += 39)
     {
         add_plant(i % map_width(), i / map_width());
@@ -710,7 +738,7 @@ void init_main_map()
 void init_next_map()
 {
      
-    Map *map = set_active_map(1);
+    set_active_map(1);
      // "Random" plants <-- UNCOMMENT IF NEED PLANTS
 //    for (int i = map_width() + 3; i < map_area(); i += 39) {
 //        add_plant(i % map_width(), i / map_width());
@@ -738,67 +766,69 @@ void init_next_map()
 }
 
 
+/**
+ * Records where the special items of the ADVANCED dungeon are, for every
+ * entity map_load/map_build reports.
+ */
+static void on_dungeon_entity(char symbol, int x, int y)
+{
+    switch (symbol) {
+        case 'A':       // GOBLIN spell
+            spell_goblin_cox = x;
+            spell_goblin_coy = y;
+            break;
+        case 'G':       // Mobs are entities; compiled maps from before
+        case 'D':       // that still have their tile, so clear it
+            map_erase(x, y);
+            if (symbol == 'G') goblin = entity_spawn(TILE_GOBLIN, x, y, BEHAVIOR_PATROL_V, 1);
+            else dragon = entity_spawn(TILE_DRAGON, x, y, BEHAVIOR_PATROL_H, 1);
+            break;
+        case 'B':       // DRAGON spell
+            spell_cox = x;
+            spell_coy = y;
+            break;
+        case 'E':       // Where the elixir drops
+            elixir_cox = x;
+            elixir_coy = y;
+            break;
+        default:
+            break;
+    }
+}
+
 void init_next_map_advanced() 
 {
-    Map *map = set_active_map(2);
-    char nextMap[20][20] = {
-        {'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'E', 'G', ' ', ' ', 'A', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', 'B', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', 'W', 'W', 'W', ' ', 'D', ' ', 'W', 'W', 'W', 'W', 'W', 'W', 'W', ' ', ' ', ' ', 'W', 'W', 'W'},
-        {'W', 'W', 'W', 'W', ' ', ' ', ' ', 'W', 'W', 'W', 'W', 'W', 'W', 'W', ' ', ' ', ' ', 'W', 'W', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', 'S', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', 'L', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
-        {'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W'}
-    };
-    for (int i = 0; i < 20; i++) {
-        for (int j = 0; j < 20; j++) {
-            if (nextMap[i][j] == 'W') {
-                add_wall(j, i, VERTICAL, 1);
-            } else if (nextMap[i][j] == 'A') {      // GOBLIN spell
-                add_spell_dark(j, i);
-                spell_goblin_cox = j;
-                spell_goblin_coy = i;
-            } 
-            else if (nextMap[i][j] == 'G') {
-                add_goblin(j, i);
-                MobileGoblin.x = j;
-                MobileGoblin.y = i;
-            }
-            else if (nextMap[i][j] == 'D') {
-                add_dragon(j, i);
-                MobileDragon.x = j;
-                MobileDragon.y = i;
-            }
-            else if (nextMap[i][j] == 'B') {      // DRAGON spell
-                add_spell(j, i);
-                spell_cox = j;
-                spell_coy = i;
-            }
-            else if (nextMap[i][j] == 'L') {
-                add_laddar(j, i);
-            }
-            else if (nextMap[i][j] == 'S') {
-                add_sign(j, i);
-            }
-            else if (nextMap[i][j] == 'E') {
-                elixir_cox = j;
-                elixir_coy = i;
-            }
-        }
+    // Reloading the dungeon brings back its mobs, alive
+    entities_clear(get_map(2));
+
+    // A compiled layout on the SD card (maps/dungeon.txt run through
+    // tools/mapc) overrides the one built into the firmware
+    if (!map_load(2, "dungeon", on_dungeon_entity)) {
+        static const char nextMap[20][20] = {
+            {'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'E', 'G', ' ', ' ', 'A', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', 'B', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', 'W', 'W', 'W', ' ', 'D', ' ', 'W', 'W', 'W', 'W', 'W', 'W', 'W', ' ', ' ', ' ', 'W', 'W', 'W'},
+            {'W', 'W', 'W', 'W', ' ', ' ', ' ', 'W', 'W', 'W', 'W', 'W', 'W', 'W', ' ', ' ', ' ', 'W', 'W', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', 'S', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', 'L', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W', 'W', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', 'W'},
+            {'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W', 'W'}
+        };
+        map_build(2, &nextMap[0][0], 20, 20, on_dungeon_entity);
     }
+    set_active_map(2);
     
     print_map();
 }
@@ -814,6 +844,8 @@ int main()
     GameInputs inputs;
     int action;
     int next_state;
+    unsigned int next_report;   // Tick count at which to print the frame counters
+    int won = 0;                // The quest is done, but speech may still show
 
     // First things first: initialize hardware
     ASSERT_P(hardware_init() == ERROR_NONE, "Hardware init failed!");
@@ -855,34 +887,72 @@ int main()
                         }
                         break;
                     }
+                    // The buttons are read by interrupts: no need to spin
+                    wait_us(TICK_US);
                 }
                 uLCD.cls();
+                uLCD.text_width(1);     // Status bars and speech use the small font
+                uLCD.text_height(1);
                 wait(.5);
                 gameState = GAME;
             case GAME:
-                // Initial drawing
+                // Initial drawing, and the music if the card has it
                 draw_game(true);
-                // Main game loop
+                music_play("theme", MUSIC_VOLUME, 1);
+                // Main game loop: the game advances in fixed ticks of real
+                // time, and a frame is drawn after each batch of ticks
+                timestep_start();
+                next_report = timestep_stats()->ticks + STATS_TICKS;
                 while(1)
                 {
-                    // Timer to measure game update speed
-                    Timer t; 
-                    t.start();
-                    // Actually do the game update:
-                    // 1. Read inputs        
-                    inputs = read_inputs();
-                    // 2. Determine action (get_action) 
-                    action = get_action(inputs);
-                    // 3. Update game (update_game)
-                    next_state = update_game(action);
-                    // 3b. Check for game over
-                    game_over(next_state);
-                    // 4. Draw frame (draw_game)
-                    draw_game(true);
-                    // 5. Frame delay
-                    t.stop();
-                    int dt = t.read_ms();
-                    if (dt < 100) wait_ms(100 - dt);
+                    // 0. Keep the music streaming, then find out how many
+                    // ticks are due; if none is, sample the accelerometer
+                    // and idle until the next tick (or the next sample)
+                    music_update();
+                    int ticks = timestep_frame();
+                    if (!ticks) {
+                        accel_update();
+                        int idle = timestep_idle_us();
+                        wait_us(idle < ACCEL_PERIOD_US ? idle : ACCEL_PERIOD_US);
+                        continue;
+                    }
+                    unsigned int frame_start = us_ticker_read();
+                    int full_draw = 0;
+                    for (int tick = 0; tick < ticks; tick++) {
+                        // Actually do the game update:
+                        // 1. Read inputs
+                        inputs = read_inputs();
+                        // 1b. Type out speech; the bubble takes the action button
+                        if (speech_update(inputs.b1)) inputs.b1 = 1;
+                        // 2. Determine action (get_action)
+                        action = get_action(inputs);
+                        // 3. Update game (update_game)
+                        next_state = update_game(action);
+                        if (next_state == FULL_DRAW) full_draw = 1;
+                        // 3b. Check for game over; winning waits until the
+                        // last words are read
+                        if (next_state == WIN) won = 1;
+                        else game_over(next_state);
+                        if (won && !speech_active()) game_over(WIN);
+                        // 3c. Page in the map around the player (streamed maps)
+                        map_prefetch(Player.x, Player.y);
+                        // 3d. Keep the enemies' way to the player current
+                        if (mode_select) {
+                            flow_set_target(Player.x, Player.y);
+                            flow_update(FLOW_BUDGET);
+                        }
+                    }
+                    // 4. Draw frame (draw_game), resending only what changed
+                    // unless an update covered the screen (e.g. speech)
+                    draw_game(full_draw);
+                    profile_record(PROFILE_FRAME, us_ticker_read() - frame_start);
+                    // 5. Report the frame counters and timings now and then
+                    if (timestep_stats()->ticks >= next_report) {
+                        print_timestep_stats();
+                        profile_print();
+                        if (music_playing()) pc.printf("music: %u underrun samples\r\n", music_underruns());
+                        next_report += STATS_TICKS;
+                    }
                 }
                 // break; // unreachable
             default:
@@ -2,6 +2,12 @@
 
 #include "globals.h"
 #include "graphics.h"
+#include "world.h"
+#include "map_format.h"
+#include "spatial_key.h"
+#include "path.h"
+
+#include <string.h>   // For memcmp
 
 /**
  * The Map structure. This holds a HashTable for all the MapItems, along with
@@ -17,8 +23,62 @@
 struct Map {
     HashTable* items;
     int w, h;
+
+    /**
+     * Dense storage. Once enough of the map is occupied (see DENSE_PERCENT),
+     * the in-bounds MapItems move out of the hash table into a w*h grid of
+     * small tile ids, indexed by y*w+x. Id 0 means the cell is empty, ids
+     * below NUM_TILE_KINDS are the shared prototype of that kind, and higher
+     * ids index per-instance items in tile_items. Items outside the w x h
+     * rectangle stay in the hash table, which also keeps allocating the
+     * instances. tiles is NULL while the map is sparse.
+     */
+    unsigned short* tiles;
+    MapItem** tile_items;       // Tile id -> MapItem
+    unsigned short* free_ids;   // Stack of tile ids released by erased items
+    int num_ids, max_ids;       // Ids handed out so far, and tile_items size
+    int num_free_ids;
+
+    int count;                  // Number of occupied in-bounds cells
+
+    /**
+     * Streamed storage. A map backed by a world file on the SD card keeps its
+     * stateless tiles (as tile kinds) in the world's chunk cache instead of
+     * RAM. Cells holding a per-instance item are marked TILE_INSTANCE there,
+     * and the item itself lives in the hash table. NULL for in-RAM maps.
+     */
+    World* world;
+
+    /**
+     * Collision layer: one bit per cell of the w x h rectangle, indexed like
+     * tiles, set where the item is not walkable. map_put and map_take keep it
+     * current, so walkability checks are a bit test instead of an item lookup.
+     * Allocated with the first blocked cell; NULL while nothing in bounds
+     * blocks. Streamed maps and cells outside the rectangle have no bits and
+     * are answered from the item itself.
+     */
+    unsigned int* blocked;
 };
 
+/**
+ * World tile value meaning "the item here is in the hash table". Instances are
+ * not saved to the card, so after a reload such a cell reads as empty.
+ */
+#define TILE_INSTANCE 0xFF
+
+/**
+ * How far around the viewport (in tiles) map_prefetch pages chunks in.
+ */
+#define PREFETCH_MARGIN 4
+
+/**
+ * A dense grid costs 2 bytes per cell plus one tile_items slot per item, while
+ * a sparse item costs a hash table entry plus its share of the bucket array,
+ * about 16 bytes. Dense breaks even at about 1/8 occupancy; since it also turns
+ * every lookup into one array index, switch a bit earlier than that.
+ */
+#define DENSE_PERCENT 10
+
 /**
  * Storage area for the maps.
  * This is a global variable, but can only be access from this file because it
@@ -27,23 +87,307 @@ struct Map {
 static Map map[3];
 static int active_map;
 
+/**
+ * Cells of the active map changed since the last map_clear_dirty, so
+ * draw_game only resends those tiles. When more than DIRTY_MAX cells change
+ * (a map load, switching maps) the whole map counts as dirty.
+ */
+#define DIRTY_MAX 32
+static struct {
+    int x[DIRTY_MAX], y[DIRTY_MAX];
+    int count;
+    int all;
+} dirty;
+
+/**
+ * The coordinate key and hash functions in use (see map_set_hashing). Packed
+ * keys are one-to-one for negative coordinates too, unlike the Cantor pairing
+ * the map used to use, and the mixer spreads the neighboring keys of a wall
+ * row over all buckets instead of a few.
+ */
+static CoordKeyFunc xy_key = packed_key;
+static HashFunction xy_hash = mix_hash;
+
 /**
  * The first step in HashTable access for the map is turning the two-dimensional
  * key information (x, y) into a one-dimensional unsigned integer.
  * This function should uniquely map (x,y) onto the space of unsigned integers.
  */
 static unsigned XY_KEY(int X, int Y) {
-    return (X + Y) * (X + Y + 1) / 2 + X;
+    return xy_key(X, Y);
 }
 
 /**
  * This is the hash function actually passed into createHashTable. It takes an
- * unsigned key (the output of XY_KEY) and turns it into a hash value (some
- * small non-negative integer).
+ * unsigned key (the output of XY_KEY) and turns it into a hash value. The hash
+ * table reduces it modulo its current bucket count, which grows with the map,
+ * so NUM_BUCKETS is only the starting size.
  */
 unsigned map_hash(unsigned key)
 {
-    return key % NUM_BUCKETS;
+    return xy_hash(key);
+}
+
+void map_set_hashing(CoordKeyFunc key, HashFunction hash)
+{
+    xy_key = key;
+    xy_hash = hash;
+}
+
+/**
+ * The shared MapItem prototypes, one per tile kind (see TILE_* in map.h).
+ * Stateless tiles - walls, plants, and everything else that leaves data NULL -
+ * all point at their kind's prototype instead of owning a MapItem, so adding
+ * one allocates nothing. Only items with per-instance data (stairs) are real
+ * allocations. The prototypes are never modified or freed.
+ */
+static const MapItem prototypes[NUM_TILE_KINDS] = {
+    { -1,         NULL,            false, NULL },   // TILE_NONE (unused)
+    { WALL,       draw_wall,       false, NULL },   // TILE_WALL
+    { PLANT,      draw_plant,      true,  NULL },   // TILE_PLANT
+    { WIZARD,     draw_npc_wizard, true,  NULL },   // TILE_WIZARD
+    { KEY,        draw_key,        true,  NULL },   // TILE_KEY
+    { SPELL,      draw_spell,      true,  NULL },   // TILE_SPELL
+    { SPELL_DARK, draw_spell_dark, true,  NULL },   // TILE_SPELL_DARK
+    { CHEST,      draw_chest,      true,  NULL },   // TILE_CHEST
+    { LADDAR,     draw_laddar,     true,  NULL },   // TILE_LADDAR
+    { DANGER,     draw_dragon,     false, NULL },   // TILE_DRAGON
+    { DANGER,     draw_goblin,     false, NULL },   // TILE_GOBLIN
+    { GRAVE,      draw_grave,      false, NULL },   // TILE_GRAVE
+    { ELIXIR,     draw_elixir,     true,  NULL },   // TILE_ELIXIR
+    { SIGN,       draw_sign,       true,  NULL },   // TILE_SIGN
+};
+
+MapItem* get_prototype(int kind)
+{
+    if (kind <= TILE_NONE || kind >= NUM_TILE_KINDS) return NULL;
+    // Callers only ever read MapItems, so handing out the shared one is safe
+    return (MapItem*) &prototypes[kind];
+}
+
+int tile_kind(const MapItem* item)
+{
+    if (item < prototypes + 1 || item >= prototypes + NUM_TILE_KINDS) return TILE_NONE;
+    return item - prototypes;
+}
+
+/**
+ * Free an item taken out of a map. Prototypes are shared and stay put; real
+ * instances go back to the table's pool along with their data.
+ */
+static void release_item(Map* map, MapItem* item)
+{
+    if (!item || tile_kind(item) != TILE_NONE) return;
+    free(item->data);
+    freeItemValue(map->items, item);
+}
+
+/**
+ * Returns nonzero if (x,y) is inside the map's w x h rectangle.
+ */
+static int in_bounds(Map* map, int x, int y)
+{
+    return x >= 0 && y >= 0 && x < map->w && y < map->h;
+}
+
+/**
+ * Returns nonzero if (x,y) is covered by the map's dense grid.
+ */
+static int in_grid(Map* map, int x, int y)
+{
+    return map->tiles && in_bounds(map, x, y);
+}
+
+/**
+ * Set or clear the collision bit of (x,y). Cells without a bit are ignored.
+ */
+static void set_blocked(Map* map, int x, int y, int blocked)
+{
+    if (map->world || !in_bounds(map, x, y)) return;
+    if (!map->blocked) {
+        if (!blocked) return;
+        map->blocked = (unsigned int*) calloc((map->w * map->h + 31) / 32, sizeof(unsigned int));
+        ASSERT_P(map->blocked, ERROR_MEH);
+    }
+    int cell = y * map->w + x;
+    if (blocked) map->blocked[cell >> 5] |= 1u << (cell & 31);
+    else map->blocked[cell >> 5] &= ~(1u << (cell & 31));
+}
+
+/**
+ * Get a tile id for item: its kind for a prototype, otherwise a fresh instance
+ * id (reusing a released one if there is one).
+ */
+static unsigned short alloc_tile_id(Map* map, MapItem* item)
+{
+    unsigned short id = tile_kind(item);
+    if (id != TILE_NONE) return id;
+
+    if (map->num_free_ids) {
+        id = map->free_ids[--map->num_free_ids];
+    } else {
+        if (map->num_ids + 1 >= map->max_ids) {
+            map->max_ids *= 2;
+            map->tile_items = (MapItem**) realloc(map->tile_items, map->max_ids * sizeof(MapItem*));
+            map->free_ids = (unsigned short*) realloc(map->free_ids, map->max_ids * sizeof(unsigned short));
+            ASSERT_P(map->tile_items && map->free_ids && map->max_ids <= 0xFFFF, ERROR_MEH);
+        }
+        id = ++map->num_ids;
+    }
+    map->tile_items[id] = item;
+    return id;
+}
+
+/**
+ * Allocate an empty dense grid for a map.
+ */
+static void alloc_grid(Map* map)
+{
+    int area = map->w * map->h;
+    map->tiles = (unsigned short*) calloc(area, sizeof(unsigned short));
+    map->max_ids = NUM_TILE_KINDS + 16;
+    map->tile_items = (MapItem**) malloc(map->max_ids * sizeof(MapItem*));
+    map->free_ids = (unsigned short*) malloc(map->max_ids * sizeof(unsigned short));
+    ASSERT_P(map->tiles && map->tile_items && map->free_ids, ERROR_MEH);
+    map->tile_items[TILE_NONE] = NULL;
+    for (int kind = 1; kind < NUM_TILE_KINDS; kind++) map->tile_items[kind] = get_prototype(kind);
+    map->num_ids = NUM_TILE_KINDS - 1;
+    map->num_free_ids = 0;
+}
+
+/**
+ * Switch a map to dense storage: allocate the grid and move every in-bounds
+ * item out of the hash table into it.
+ */
+static void make_dense(Map* map)
+{
+    alloc_grid(map);
+    for (int y = 0; y < map->h; y++) {
+        for (int x = 0; x < map->w; x++) {
+            MapItem* item = (MapItem*) removeItem(map->items, XY_KEY(x, y));
+            if (item) map->tiles[y * map->w + x] = alloc_tile_id(map, item);
+        }
+    }
+}
+
+/**
+ * Look up the item at (x,y) in whichever storage holds that cell.
+ */
+static MapItem* map_get(Map* map, int x, int y)
+{
+    if (map->world) {
+        int tile = world_get(map->world, x, y);
+        if (tile >= 0 && tile != TILE_INSTANCE) return get_prototype(tile);
+        if (tile < 0) return NULL;
+    }
+    if (in_grid(map, x, y)) return map->tile_items[map->tiles[y * map->w + x]];
+    return (MapItem*) getItem(map->items, XY_KEY(x, y));
+}
+
+/**
+ * Returns nonzero if (x,y) holds an item that cannot be walked on.
+ */
+static int is_blocked(Map* map, int x, int y)
+{
+    if (map->world || !in_bounds(map, x, y)) {
+        MapItem* item = map_get(map, x, y);
+        return item && !item->walkable;
+    }
+    if (!map->blocked) return 0;
+    int cell = y * map->w + x;
+    return (map->blocked[cell >> 5] >> (cell & 31)) & 1;
+}
+
+/**
+ * Record that (x,y) of map m changed. Only the active map is on screen.
+ */
+static void mark_dirty(Map* m, int x, int y)
+{
+    if (m != get_active_map()) return;
+    map_mark_dirty(x, y);
+}
+
+/**
+ * Take the item at (x,y) out of the map and return it (NULL if empty).
+ */
+static MapItem* map_take(Map* map, int x, int y)
+{
+    MapItem* item;
+    mark_dirty(map, x, y);
+    set_blocked(map, x, y, 0);
+    if (map->world) {
+        int tile = world_get(map->world, x, y);
+        if (tile != TILE_INSTANCE) {
+            if (tile > 0) world_set(map->world, x, y, TILE_NONE);
+            return get_prototype(tile);
+        }
+        world_set(map->world, x, y, TILE_NONE);
+        return (MapItem*) removeItem(map->items, XY_KEY(x, y));
+    }
+    if (in_grid(map, x, y)) {
+        unsigned short* tile = &map->tiles[y * map->w + x];
+        if (!*tile) return NULL;
+        item = map->tile_items[*tile];
+        if (*tile >= NUM_TILE_KINDS) {
+            map->free_ids[map->num_free_ids++] = *tile;
+            map->tile_items[*tile] = NULL;
+        }
+        *tile = 0;
+    } else {
+        item = (MapItem*) removeItem(map->items, XY_KEY(x, y));
+    }
+    if (item && in_bounds(map, x, y)) map->count--;
+    return item;
+}
+
+/**
+ * Place item at (x,y), freeing whatever was there before. Switches the map to
+ * dense storage once it is full enough. A NULL item is ignored: the storage
+ * only ever holds real items, so a cell is present exactly when it has one.
+ */
+static void map_put(Map* map, int x, int y, MapItem* item)
+{
+    if (!item) return;
+    if (!map->world && !in_grid(map, x, y)) {
+        // Sparse cell: find or add the entry in one traversal, then free
+        // whatever was there and store the new item in its place
+        int inserted;
+        mark_dirty(map, x, y);
+        void** slot = findOrInsert(map->items, XY_KEY(x, y), &inserted);
+        if (!slot) {
+            release_item(map, item); // Out of memory: the cell stays empty
+            return;
+        }
+        if (!inserted) release_item(map, (MapItem*) *slot);
+        *slot = item;
+        set_blocked(map, x, y, item && !item->walkable);
+        if (inserted && in_bounds(map, x, y)) {
+            map->count++;
+            if (!map->tiles && map->count * 100 >= map->w * map->h * DENSE_PERCENT) make_dense(map);
+        }
+        return;
+    }
+
+    release_item(map, map_take(map, x, y)); // If something is already there, free it
+
+    if (map->world) {
+        // Cells outside the world are not stored at all
+        int kind = tile_kind(item);
+        if (kind != TILE_NONE) {
+            world_set(map->world, x, y, kind);
+        } else if (world_get(map->world, x, y) >= 0) {
+            world_set(map->world, x, y, TILE_INSTANCE);
+            insertItem(map->items, XY_KEY(x, y), item);
+        } else {
+            release_item(map, item);
+        }
+        return;
+    }
+
+    // Dense cell
+    map->tiles[y * map->w + x] = alloc_tile_id(map, item);
+    set_blocked(map, x, y, item && !item->walkable);
+    map->count++;
 }
 
 void maps_init()
@@ -59,6 +403,187 @@ void maps_init()
     map[2].items = createHashTable(map_hash,  NUM_BUCKETS);
     map[2].h = 20;
     map[2].w = 20;
+
+    // Per-instance MapItems come from each table's slab pool; the pooled
+    // table also leaves the shared prototypes alone when it frees values
+    for (int m = 0; m < 3; m++) enableValuePool(map[m].items, sizeof(MapItem));
+}
+
+/**
+ * forEachItem visitor that frees the data of an instance item. The item
+ * itself goes back with the table's pool.
+ */
+static void release_data(unsigned int key, void* value, void* context)
+{
+    MapItem* item = (MapItem*) value;
+    if (item && tile_kind(item) == TILE_NONE) free(item->data);
+}
+
+/**
+ * Empty a map and return it to plain sparse storage, ready to be refilled.
+ * Everything goes, including items outside the w x h rectangle, and the cost
+ * depends on what the map holds rather than on its size.
+ */
+static void map_clear(Map* map)
+{
+    if (map->world) {
+        world_close(map->world);
+        map->world = NULL;
+    }
+
+    // Instances hold data of their own; the rest is freed in bulk with the
+    // table and its pool
+    forEachItem(map->items, release_data, NULL);
+    if (map->tile_items) {
+        for (int id = NUM_TILE_KINDS; id <= map->num_ids; id++) {
+            if (map->tile_items[id]) free(map->tile_items[id]->data);
+        }
+    }
+    destroyHashTable(map->items);
+    map->items = createHashTable(map_hash, NUM_BUCKETS);
+    ASSERT_P(map->items, ERROR_MEH);
+    enableValuePool(map->items, sizeof(MapItem));
+
+    free(map->tiles);
+    free(map->tile_items);
+    free(map->free_ids);
+    free(map->blocked);
+    map->tiles = NULL;
+    map->tile_items = NULL;
+    map->free_ids = NULL;
+    map->blocked = NULL;
+    map->count = 0;
+    map->w = map->h = 0;    // The caller sets the size of what comes next
+}
+
+Map* map_stream_world(int m, const char* name)
+{
+    World* world = world_open(name);
+    if (!world) return NULL;
+
+    // Anything the map held is dropped, a world it streamed before included
+    // (even the same one, which starts over as shipped); the world replaces it
+    map_clear(&map[m]);
+    map[m].world = world;
+    map[m].w = world_width(world);
+    map[m].h = world_height(world);
+    return &map[m];
+}
+
+static unsigned int read_u16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+static long read_u32(const unsigned char* p) { return read_u16(p) | ((long)read_u16(p + 2) << 16); }
+
+Map* map_load(int m, const char* name, MapEntityFunc on_entity)
+{
+    char path[64];
+    unsigned char buf[64];
+    snprintf(path, sizeof(path), "%s/maps/%s.map", WORLD_ROOT, name);
+    FILE* file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    if (fread(buf, 1, MAP_HEADER_SIZE, file) != MAP_HEADER_SIZE
+        || memcmp(buf, MAP_MAGIC, 4) != 0 || read_u16(buf + 4) != MAP_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+    int w = read_u16(buf + 6);
+    int h = read_u16(buf + 8);
+    long occupied = read_u32(buf + 10);
+    long entities = read_u32(buf + 14);
+    long tile_bytes = read_u32(buf + 18);
+    if (!w || !h || (long)w * h > MAP_MAX_AREA || occupied > (long)w * h) {
+        fclose(file);
+        return NULL;
+    }
+
+    Map* dst = &map[m];
+    map_clear(dst);
+    dst->w = w;
+    dst->h = h;
+
+    // The header says how full the map is, so the storage is chosen once up
+    // front and the tile layer is written straight into it
+    if (occupied * 100 >= (long)w * h * DENSE_PERCENT) alloc_grid(dst);
+
+    int cell = 0;
+    while (tile_bytes > 0) {
+        int n = fread(buf, 1, tile_bytes < (long)sizeof(buf) ? tile_bytes : sizeof(buf), file);
+        if (n <= 0 || (n & 1)) break;
+        tile_bytes -= n;
+        for (int i = 0; i < n; i += 2) {
+            int count = buf[i];
+            int kind = buf[i + 1];
+            if (kind >= NUM_TILE_KINDS) kind = TILE_NONE;
+            if (count > w * h - cell) count = w * h - cell;
+            if (kind != TILE_NONE && !prototypes[kind].walkable) {
+                for (int c = cell; c < cell + count; c++) set_blocked(dst, c % w, c / w, 1);
+            }
+            if (kind == TILE_NONE) {
+                cell += count;
+            } else if (dst->tiles) {
+                // Prototype tile ids are the kinds themselves
+                for (; count > 0; count--) dst->tiles[cell++] = kind;
+            } else {
+                for (; count > 0; count--, cell++) {
+                    insertItem(dst->items, XY_KEY(cell % w, cell / w), get_prototype(kind));
+                }
+            }
+        }
+    }
+    dst->count = occupied;
+
+    // Entities: attach payloads, then tell the game where they are
+    Map* prev = get_active_map();
+    set_active_map(m);
+    for (long e = 0; e < entities; e++) {
+        if (fread(buf, 1, 6, file) != 6) break;
+        char symbol = buf[0];
+        int x = read_u16(buf + 1);
+        int y = read_u16(buf + 3);
+        // Only the start of a payload is ever used; skip whatever does not fit
+        int payload = buf[5];
+        int keep = payload < (int)sizeof(buf) ? payload : (int)sizeof(buf);
+        if (fread(buf, 1, keep, file) != (size_t)keep) break;
+        if (payload > keep && fseek(file, payload - keep, SEEK_CUR)) break;
+        if (map_legend_kind(symbol) == TILE_LADDAR && payload == MAP_STAIRS_PAYLOAD) {
+            add_stairs(x, y, read_u16(buf), read_u16(buf + 2), read_u16(buf + 4));
+        }
+        if (on_entity) on_entity(symbol, x, y);
+    }
+    active_map = prev - map;
+
+    fclose(file);
+    return dst;
+}
+
+Map* map_build(int m, const char* cells, int w, int h, MapEntityFunc on_entity)
+{
+    Map* dst = &map[m];
+    map_clear(dst);
+    dst->w = w;
+    dst->h = h;
+
+    Map* prev = get_active_map();
+    set_active_map(m);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            char symbol = cells[y * w + x];
+            int kind = map_legend_kind(symbol);
+            if (kind > TILE_NONE) add_tile(x, y, kind);
+            if (on_entity && map_legend_is_entity(symbol)) on_entity(symbol, x, y);
+        }
+    }
+    active_map = prev - map;
+    return dst;
+}
+
+void map_prefetch(int x, int y)
+{
+    Map* map = get_active_map();
+    if (!map->world) return;
+    // The viewport is 11x9 tiles centered on (x,y)
+    world_prefetch(map->world, x - 5 - PREFETCH_MARGIN, y - 4 - PREFETCH_MARGIN,
+                   x + 5 + PREFETCH_MARGIN, y + 4 + PREFETCH_MARGIN);
 }
 
 Map* get_active_map()
@@ -67,22 +592,73 @@ Map* get_active_map()
     return &map[active_map];
 }
 
+Map* get_map(int m)
+{
+    return &map[m];
+}
+
 Map* set_active_map(int m)
 {
     active_map = m;
+    dirty.all = 1; // Everything on screen changes
     return &map[active_map];
 }
 
+void map_mark_dirty(int x, int y)
+{
+    if (dirty.all || map_is_dirty(x, y)) return;
+    if (dirty.count == DIRTY_MAX) {
+        dirty.all = 1;
+        return;
+    }
+    dirty.x[dirty.count] = x;
+    dirty.y[dirty.count] = y;
+    dirty.count++;
+}
+
+int map_is_dirty(int x, int y)
+{
+    if (dirty.all) return 1;
+    for (int i = 0; i < dirty.count; i++)
+        if (dirty.x[i] == x && dirty.y[i] == y) return 1;
+    return 0;
+}
+
+void map_clear_dirty()
+{
+    dirty.count = 0;
+    dirty.all = 0;
+}
+
+void print_map_stats()
+{
+    Map* map = get_active_map();
+    HashTableStats stats;
+    getHashTableStats(map->items, &stats);
+
+    pc.printf("map %d: %dx%d, %d items, %s\r\n", active_map, map->w, map->h, map->count,
+              map->world ? "streamed" : map->tiles ? "dense grid" : "sparse");
+    pc.printf("hash table: %u items in %u buckets, longest chain %u\r\n",
+              stats.num_items, stats.num_buckets, stats.max_chain);
+    pc.printf("chain lengths:");
+    for (int i = 0; i < HASH_STATS_BINS; i++) {
+        pc.printf(" %d%s:%u", i, i == HASH_STATS_BINS - 1 ? "+" : "", stats.histogram[i]);
+    }
+    pc.printf("\r\n");
+}
+
 void print_map()
 {
     // As you add more types, you'll need to add more items to this array.
-    char lookup[] = {'W', 'P'};
+    // Indexed by MapItem type; DANGER covers both the dragon and the goblin.
+    char lookup[] = {'W', 'P', 'M', 'K', 'B', 'C', 'L', 'A', 'D', 'X', 'E', 'S'};
     for(int y = 0; y < map_height(); y++)
     {
         for (int x = 0; x < map_width(); x++)
         {
             MapItem* item = get_here(x,y);
-            if (item) pc.printf("%c", lookup[item->type]);
+            if (item && item->type < (int) sizeof(lookup)) pc.printf("%c", lookup[item->type]);
+            else if (item) pc.printf("?");
             else pc.printf(" ");
         }
         pc.printf("\r\n");
@@ -110,195 +686,190 @@ int map_area()
 MapItem* get_north(int x, int y)
 {
     Map* map = get_active_map();
-    return (MapItem *)getItem(map->items, XY_KEY(x, y - 1));
+    return map_get(map, x, y - 1);
 }
 
 MapItem* get_south(int x, int y)
 {
     Map* map = get_active_map();
-    return (MapItem *)getItem(map->items, XY_KEY(x, y + 1));
+    return map_get(map, x, y + 1);
 }
 
 MapItem* get_east(int x, int y)
 {
     Map* map = get_active_map();
-    return (MapItem *)getItem(map->items, XY_KEY(x + 1, y));
+    return map_get(map, x + 1, y);
 }
 
 MapItem* get_west(int x, int y)
 {
     Map* map = get_active_map();
-    return (MapItem *)getItem(map->items, XY_KEY(x - 1, y));
+    return map_get(map, x - 1, y);
 }
 
 MapItem* get_here(int x, int y)
 {
     Map* map = get_active_map();
-    return (MapItem *)getItem(map->items, XY_KEY(x, y));
+    return map_get(map, x, y);
+}
+
+
+void map_region(int x0, int y0, int w, int h, MapItem** out)
+{
+    Map* map = get_active_map();
+    for (int j = 0; j < h; j++) {
+        int y = y0 + j;
+        MapItem** row = out + j * w;
+
+        // Rows fully inside a dense grid are a straight walk over the tile ids
+        if (map->tiles && !map->world && y >= 0 && y < map->h && x0 >= 0 && x0 + w <= map->w) {
+            const unsigned short* tiles = map->tiles + y * map->w + x0;
+            for (int i = 0; i < w; i++) row[i] = map->tile_items[tiles[i]];
+            continue;
+        }
+        for (int i = 0; i < w; i++) row[i] = map_get(map, x0 + i, y);
+    }
 }
 
+int map_blocked(int x, int y)
+{
+    return is_blocked(get_active_map(), x, y);
+}
+
+int map_blocked_neighbors(int x, int y)
+{
+    Map* map = get_active_map();
+    return (is_blocked(map, x, y - 1) ? BLOCKED_N : 0)
+         | (is_blocked(map, x, y + 1) ? BLOCKED_S : 0)
+         | (is_blocked(map, x + 1, y) ? BLOCKED_E : 0)
+         | (is_blocked(map, x - 1, y) ? BLOCKED_W : 0);
+}
+
+unsigned int map_blocked_row(int x0, int y, int n)
+{
+    Map* map = get_active_map();
+    if (n > 32) n = 32;
+    if (n <= 0) return 0;
+
+    // Spans inside the rectangle are at most two words of the bitset
+    if (!map->world && y >= 0 && y < map->h && x0 >= 0 && x0 + n <= map->w) {
+        if (!map->blocked) return 0;
+        int cell = y * map->w + x0;
+        int shift = cell & 31;
+        unsigned int bits = map->blocked[cell >> 5] >> shift;
+        if (shift + n > 32) bits |= map->blocked[(cell >> 5) + 1] << (32 - shift);
+        return n < 32 ? bits & ((1u << n) - 1) : bits;
+    }
+
+    unsigned int bits = 0;
+    for (int i = 0; i < n; i++) {
+        if (is_blocked(map, x0 + i, y)) bits |= 1u << i;
+    }
+    return bits;
+}
+
+/**
+ * Have the flow field (path.h) swept again if (x,y) of the active map turned
+ * walkable or unwalkable, so enemies do not route through a new grave.
+ */
+static void check_walkability(Map* map, int x, int y, int was_blocked)
+{
+    if (is_blocked(map, x, y) != was_blocked) flow_invalidate();
+}
 
 void map_erase(int x, int y)
 {
     Map* map = get_active_map();
-    removeItem(map->items, XY_KEY(x, y));
+    int was_blocked = is_blocked(map, x, y);
+    release_item(map, map_take(map, x, y));
+    check_walkability(map, x, y, was_blocked);
+}
+
+void add_tile(int x, int y, int kind)
+{
+    // Unknown kinds have no prototype and are ignored (see map_put)
+    MapItem* item = get_prototype(kind);
+    if (!item) return;
+    Map* map = get_active_map();
+    int was_blocked = is_blocked(map, x, y);
+    map_put(map, x, y, item);
+    check_walkability(map, x, y, was_blocked);
+}
+
+void add_stairs(int x, int y, int tm, int tx, int ty)
+{
+    Map* map = get_active_map();
+
+    // Stairs need their own destination, so they get a real instance: a copy
+    // of the LADDAR prototype plus a StairsData
+    StairsData* stairs = (StairsData*) malloc(sizeof(StairsData));
+    MapItem* item = (MapItem*) allocItemValue(map->items);
+    ASSERT_P(stairs && item, ERROR_MEH);
+    stairs->tm = tm;
+    stairs->tx = tx;
+    stairs->ty = ty;
+    *item = prototypes[TILE_LADDAR];
+    item->data = stairs;
+    int was_blocked = is_blocked(map, x, y);
+    map_put(map, x, y, item);
+    check_walkability(map, x, y, was_blocked);
 }
 
 void add_wall(int x, int y, int dir, int len)
 {
     for(int i = 0; i < len; i++)
     {
-        MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-        w1->type = WALL;
-        w1->draw = draw_wall;
-        w1->walkable = false;
-        w1->data = NULL;
-        unsigned key = (dir == HORIZONTAL) ? XY_KEY(x+i, y) : XY_KEY(x, y+i);
-        void* val = insertItem(get_active_map()->items, key, w1);
-        if (val) free(val); // If something is already there, free it
+        if (dir == HORIZONTAL) add_tile(x+i, y, TILE_WALL);
+        else add_tile(x, y+i, TILE_WALL);
     }
 }
 
 void add_plant(int x, int y)
 {
-    MapItem* w1 = (MapItem*) malloc(sizeof(MapItem));
-    w1->type = PLANT;
-    w1->draw = draw_plant;
-    w1->walkable = true;
-    w1->data = NULL;
-    void* val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val) free(val); // If something is already there, free it
+    add_tile(x, y, TILE_PLANT);
 }
 
 void add_npc_wizard(int x, int y)
 {
-    MapItem* w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = WIZARD;
-    w1->draw = draw_npc_wizard;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_WIZARD);
 }
 
 void add_key(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = KEY;
-    w1->draw = draw_key;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_KEY);
 }
 
 void add_spell(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = SPELL;
-    w1->draw = draw_spell;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_SPELL);
 }
 
 void add_spell_dark(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = SPELL_DARK;
-    w1->draw = draw_spell_dark;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_SPELL_DARK);
 }
 
 void add_chest(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = CHEST;
-    w1->draw = draw_chest;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_CHEST);
 }
 
 void add_laddar(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = LADDAR;
-    w1->draw = draw_laddar;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
-}
-
-void add_dragon(int x, int y)
-{
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = DANGER;
-    w1->draw = draw_dragon;
-    w1->walkable = false;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
-}
-
-void add_goblin(int x, int y)
-{
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = DANGER;
-    w1->draw = draw_goblin;
-    w1->walkable = false;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_LADDAR);
 }
 
 void add_grave(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = GRAVE;
-    w1->draw = draw_grave;
-    w1->walkable = false;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_GRAVE);
 }
 
 void add_elixir(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = ELIXIR;
-    w1->draw = draw_elixir;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_ELIXIR);
 }
 
 void add_sign(int x, int y)
 {
-    MapItem *w1 = (MapItem *)malloc(sizeof(MapItem));
-    w1->type = SIGN;
-    w1->draw = draw_sign;
-    w1->walkable = true;
-    w1->data = NULL;
-    void *val = insertItem(get_active_map()->items, XY_KEY(x, y), w1);
-    if (val)
-        free(val); // If something is already there, free it
+    add_tile(x, y, TILE_SIGN);
 }
-
@@ -2,6 +2,7 @@
 #define MAP_H
 
 #include "hash_table.h"
+#include "spatial_key.h"
 
 /**
  * A structure to represent the map. The implementation is private.
@@ -66,6 +67,38 @@ typedef struct {
 #define ELIXIR  10
 #define SIGN    11
 
+// Tile kinds. Every kind has one shared, read-only MapItem prototype, and a
+// tile with no per-instance data is stored as just its kind. Several kinds can
+// share a type (the dragon and goblin are both DANGER). The dragon and goblin
+// kinds are only drawn: the mobs themselves are entities (see entity.h).
+#define TILE_NONE       0
+#define TILE_WALL       1
+#define TILE_PLANT      2
+#define TILE_WIZARD     3
+#define TILE_KEY        4
+#define TILE_SPELL      5
+#define TILE_SPELL_DARK 6
+#define TILE_CHEST      7
+#define TILE_LADDAR     8
+#define TILE_DRAGON     9
+#define TILE_GOBLIN     10
+#define TILE_GRAVE      11
+#define TILE_ELIXIR     12
+#define TILE_SIGN       13
+#define NUM_TILE_KINDS  14
+
+/**
+ * Returns the shared prototype MapItem of a tile kind, or NULL for TILE_NONE
+ * or an unknown kind. Prototypes must not be modified.
+ */
+MapItem* get_prototype(int kind);
+
+/**
+ * Returns the tile kind of a MapItem if it is a shared prototype, or TILE_NONE
+ * if it is a per-instance item (or NULL).
+ */
+int tile_kind(const MapItem* item);
+
 /**
  * Initializes the internal structures for all maps. This does not populate
  * the map with items, but allocates space for them, initializes the hash tables, 
@@ -73,6 +106,56 @@ typedef struct {
  */
 void maps_init();
 
+/**
+ * Back map m with the streamed world file WORLD_ROOT/worlds/<name>.wld (see
+ * world.h) instead of RAM, replacing its contents and size. Only a bounded
+ * cache of chunks stays in memory. The world is opened for play, so changes
+ * to the map last until it is replaced and the file stays as shipped. A
+ * world the map streamed before is closed first, the same one included, so
+ * streaming it again starts it over. Returns NULL if the world cannot be
+ * opened, in which case the map is left alone.
+ */
+Map* map_stream_world(int m, const char* name);
+
+/**
+ * Called by map_load and map_build for every entity in a layout (anything but
+ * walls, plants and empty space), after it has been placed on the map, with
+ * its layout symbol (see map_format.h) and position.
+ */
+typedef void (*MapEntityFunc)(char symbol, int x, int y);
+
+/**
+ * Replace the contents of map m with the compiled map file
+ * WORLD_ROOT/maps/<name>.map (see map_format.h and tools/mapc.cpp). The tile
+ * layer is decoded straight into the map's storage in one pass. Returns NULL
+ * if the file is missing or invalid.
+ */
+Map* map_load(int m, const char* name, MapEntityFunc on_entity);
+
+/**
+ * Replace the contents of map m with a w x h ASCII layout (row-major, one
+ * character per cell, using the legend in map_format.h). This is the in-RAM
+ * counterpart of map_load for layouts built into the firmware.
+ */
+Map* map_build(int m, const char* cells, int w, int h, MapEntityFunc on_entity);
+
+/**
+ * If the active map is streamed, page in the chunks around a viewport centered
+ * on (x,y). Call whenever the player moves; it does nothing for in-RAM maps.
+ */
+void map_prefetch(int x, int y);
+
+/**
+ * Dirty-tile tracking for the active map. map_erase and the add_* functions
+ * mark the cells they change; anything else that changes how a cell looks
+ * (a player or mob moving without touching the map) marks it by hand.
+ * draw_game resends only dirty cells and then clears the set. Switching maps
+ * marks every cell.
+ */
+void map_mark_dirty(int x, int y);
+int map_is_dirty(int x, int y);
+void map_clear_dirty();
+
 /**
  * Returns a pointer to the active map.
  */
@@ -95,6 +178,21 @@ Map* get_map(int m);
  */
 void print_map();
 
+/**
+ * Print how the active map is stored and how evenly its hash table spreads
+ * the items: items per bucket and the chain length histogram (see
+ * getHashTableStats). Useful to compare map_set_hashing choices.
+ */
+void print_map_stats();
+
+/**
+ * Choose how map coordinates become hash table keys (key) and how keys are
+ * hashed (hash); see spatial_key.h. The default is packed_key with mix_hash.
+ * Call it before maps_init: items already in a table would not be found
+ * under a different key or hash.
+ */
+void map_set_hashing(CoordKeyFunc key, HashFunction hash);
+
 // Access
 /**
  * Returns the width of the active map.
@@ -136,6 +234,40 @@ MapItem* get_west(int x, int y);
  */
 MapItem* get_here(int x, int y);
 
+/**
+ * Fills out with the MapItems of the w x h window whose top left cell is
+ * (x0,y0), in row-major order: out[j*w + i] is the item at (x0+i, y0+j), or
+ * NULL. out must have room for w*h pointers. This is the same as calling
+ * get_here for every cell, but walks the map's storage once.
+ */
+void map_region(int x0, int y0, int w, int h, MapItem** out);
+
+// Collision
+/**
+ * Returns nonzero if the item at (x,y) of the active map cannot be walked on.
+ * Empty cells are walkable. In-bounds cells of in-RAM maps are answered from
+ * the map's collision bitset without looking the item up.
+ */
+int map_blocked(int x, int y);
+
+// Neighbor bits returned by map_blocked_neighbors
+#define BLOCKED_N   1
+#define BLOCKED_S   2
+#define BLOCKED_E   4
+#define BLOCKED_W   8
+
+/**
+ * Returns the BLOCKED_* bits of the four cells next to (x,y) that cannot be
+ * walked on.
+ */
+int map_blocked_neighbors(int x, int y);
+
+/**
+ * Returns which of the n cells (x0,y) .. (x0+n-1,y) cannot be walked on, as a
+ * mask whose bit i is cell (x0+i,y). n is at most 32.
+ */
+unsigned int map_blocked_row(int x0, int y, int n);
+
 // Directions, for using the modification functions
 #define HORIZONTAL  0
 #define VERTICAL    1
@@ -145,6 +277,19 @@ MapItem* get_here(int x, int y);
  */
 void map_erase(int x, int y);
 
+/**
+ * Add a stateless tile of the given kind at (x,y), erasing whatever was there.
+ * This stores the shared prototype, so it allocates nothing. A kind outside
+ * TILE_NONE < kind < NUM_TILE_KINDS is ignored and leaves the cell as it was.
+ */
+void add_tile(int x, int y, int kind);
+
+/**
+ * Add a LADDAR at (x,y) that leads to (tx,ty) on map tm. The destination is
+ * kept in a StairsData in the item's data field.
+ */
+void add_stairs(int x, int y, int tm, int tx, int ty);
+
 /**
  * Add WALL items in a line of length len beginning at (x,y).
  * If dir == HORIZONTAL, the line is in the direction of increasing x.
@@ -192,10 +337,6 @@ void add_spell(int x, int y);
  */
 void add_spell_dark(int x, int y);
 
-void add_dragon(int x, int y);
-
-void add_goblin(int x, int y);
-
 void add_grave(int x, int y);
 
 void add_elixir(int x, int y);
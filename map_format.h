@@ -0,0 +1,84 @@
+#ifndef MAP_FORMAT_H
+#define MAP_FORMAT_H
+
+/**
+ * The compiled map file format (.map), shared by the loader in map.cpp and the
+ * host-side compiler in tools/mapc.cpp. All integers are little endian.
+ *
+ *  Header (MAP_HEADER_SIZE bytes)
+ *      "RQMP"          magic
+ *      u16 version     MAP_VERSION
+ *      u16 w, h        size in tiles
+ *      u32 occupied    number of non-empty cells (lets the loader pick dense
+ *                      or sparse storage before reading any tile)
+ *      u32 entities    number of entity records
+ *      u32 tile bytes  size of the tile layer that follows
+ *
+ *  Tile layer: w*h tile kinds (TILE_* from map.h) in row-major order, run
+ *  length encoded as (u8 count, u8 kind) pairs with 1 <= count <= 255.
+ *
+ *  Entity list: one record per layout symbol the game cares about (anything
+ *  but walls, plants and empty space). The entity's tile is already in the
+ *  tile layer; the record tells the game where it is and carries extra data.
+ *      u8  symbol      the layout character, e.g. 'G' for the goblin
+ *      u16 x, y
+ *      u8  payload     payload length in bytes
+ *      ...             payload; for a ladder, 6 bytes (u16 tm, tx, ty) make
+ *                      it a StairsData ladder
+ */
+#define MAP_MAGIC "RQMP"
+#define MAP_VERSION 2          // 1 had u16 counts, too small past 65535 cells
+#define MAP_HEADER_SIZE 22
+#define MAP_STAIRS_PAYLOAD 6
+
+/**
+ * The largest w*h the loader accepts (tools/mapc.cpp compiles layouts up to
+ * 1024x1024). Anything bigger is taken for a corrupt header.
+ */
+#define MAP_MAX_AREA (1024L * 1024L)
+
+/**
+ * The layout legend: which tile kind each ASCII layout character becomes.
+ * 'E' only marks a spot (where the elixir drops) and places nothing, and so
+ * do the mobs 'D' and 'G': the game spawns them as entities (see entity.h).
+ */
+static const struct {
+    char symbol;
+    unsigned char kind;
+} MAP_LEGEND[] = {
+    { ' ', TILE_NONE },
+    { 'W', TILE_WALL },
+    { 'P', TILE_PLANT },
+    { 'M', TILE_WIZARD },
+    { 'K', TILE_KEY },
+    { 'B', TILE_SPELL },
+    { 'A', TILE_SPELL_DARK },
+    { 'C', TILE_CHEST },
+    { 'L', TILE_LADDAR },
+    { 'D', TILE_NONE },
+    { 'G', TILE_NONE },
+    { 'X', TILE_GRAVE },
+    { 'S', TILE_SIGN },
+    { 'E', TILE_NONE },
+};
+
+/**
+ * Returns the tile kind for a layout symbol, or -1 if the symbol is unknown.
+ */
+static inline int map_legend_kind(char symbol)
+{
+    for (unsigned int i = 0; i < sizeof(MAP_LEGEND) / sizeof(MAP_LEGEND[0]); i++) {
+        if (MAP_LEGEND[i].symbol == symbol) return MAP_LEGEND[i].kind;
+    }
+    return -1;
+}
+
+/**
+ * Returns nonzero if a layout symbol gets an entity record.
+ */
+static inline int map_legend_is_entity(char symbol)
+{
+    return symbol != ' ' && symbol != 'W' && symbol != 'P' && map_legend_kind(symbol) >= 0;
+}
+
+#endif // MAP_FORMAT_H
@@ -0,0 +1,222 @@
+#include "music.h"
+#include "audio.h"
+#include "world.h"
+#include "profile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * The stream. Each buffer belongs to the game loop while its count is 0 and
+ * to the interrupt while it is not: music_update fills a buffer before
+ * publishing its count, and the interrupt zeroes the count once it has
+ * played the buffer. Both take the buffers in turn, so the data stays in
+ * order.
+ */
+static signed char blocks[2][MUSIC_BLOCK];
+static volatile int filled[2];          // Samples in each buffer
+
+static struct {
+    FILE* file;
+    long data_start;                    // Offset of the first sample
+    unsigned long frames;               // Frames (samples per channel) in the file
+    unsigned long frames_left;          // Frames not yet read
+    int channels, bytes;                // Per sample of one channel
+    int loop;
+    int writing;                        // Buffer music_update fills next
+    volatile int active;                // Whether the interrupt plays the stream
+    volatile int streaming;             // Whether more data will come
+    int volume;
+
+    // Interrupt side
+    int reading;                        // Buffer being played
+    unsigned int pos;                   // Position in it, 16.16 fixed point
+    unsigned int step;                  // File samples per output sample, 16.16
+    volatile unsigned int underruns;
+} music;
+
+static unsigned int read_le16(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned long read_le32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | ((unsigned long) p[2] << 16) | ((unsigned long) p[3] << 24);
+}
+
+/**
+ * Read the RIFF header of file up to the start of the samples and fill in
+ * the format. Returns 0, or -1 if it is not a WAV file this can play.
+ */
+static int read_header(FILE* file, unsigned int* rate)
+{
+    unsigned char riff[12], chunk[8], fmt[16];
+    if (fread(riff, 1, 12, file) != 12) return -1;
+    if (memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) return -1;
+
+    int have_fmt = 0;
+    while (fread(chunk, 1, 8, file) == 8) {
+        unsigned long size = read_le32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+            if (fread(fmt, 1, 16, file) != 16) return -1;
+            if (read_le16(fmt) != 1) return -1;         // PCM only
+            music.channels = read_le16(fmt + 2);
+            *rate = read_le32(fmt + 4);
+            music.bytes = read_le16(fmt + 14) / 8;
+            if (music.channels < 1 || music.channels > 2) return -1;
+            if (music.bytes < 1 || music.bytes > 2 || !*rate) return -1;
+            have_fmt = 1;
+            fseek(file, size - 16 + (size & 1), SEEK_CUR);
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!have_fmt) return -1;
+            music.data_start = ftell(file);
+            music.frames = size / (music.channels * music.bytes);
+            return music.frames ? 0 : -1;
+        } else {
+            fseek(file, size + (size & 1), SEEK_CUR);
+        }
+    }
+    return -1;
+}
+
+int music_play(const char* name, int volume, int loop)
+{
+    music_stop();
+
+    char path[64];
+    snprintf(path, sizeof(path), "%s/music/%s.wav", WORLD_ROOT, name);
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    unsigned int rate;
+    if (read_header(file, &rate)) {
+        fclose(file);
+        return -1;
+    }
+
+    music.file = file;
+    music.frames_left = music.frames;
+    music.loop = loop;
+    music.writing = 0;
+    music.volume = volume < 0 ? 0 : volume > AUDIO_MAX_VOLUME ? AUDIO_MAX_VOLUME : volume;
+    music.reading = 0;
+    music.pos = 0;
+    music.step = (unsigned int) (((unsigned long long) rate << 16) / AUDIO_RATE);
+    music.underruns = 0;
+    filled[0] = filled[1] = 0;
+    music.streaming = 1;
+
+    // Have data ready before the interrupt looks
+    music_update();
+    music.active = 1;
+    audio_wake();
+    return 0;
+}
+
+void music_stop()
+{
+    music.active = 0;
+    music.streaming = 0;
+    if (music.file) fclose(music.file);
+    music.file = NULL;
+}
+
+/**
+ * Read frames from the file into the end of buffer b and mix them down to
+ * signed 8-bit mono samples at w onward. Sample j only overwrites bytes of
+ * frames before frame j, so the conversion works in place. Returns the number
+ * of samples.
+ */
+static int read_frames(int b, int w)
+{
+    int frame = music.channels * music.bytes;
+    unsigned long want = (MUSIC_BLOCK - w) / frame;
+    if (want > music.frames_left) want = music.frames_left;
+    if (!want) return 0;
+
+    unsigned char* raw = (unsigned char*) blocks[b] + MUSIC_BLOCK - want * frame;
+    int got = fread(raw, frame, want, music.file);
+    music.frames_left -= got;
+    if (got < (int) want) music.frames_left = 0;    // Cut short: treat as the end
+
+    for (int j = 0; j < got; j++) {
+        const unsigned char* p = raw + j * frame;
+        int sum = 0;
+        for (int c = 0; c < music.channels; c++) {
+            if (music.bytes == 1) sum += p[c] - 128;        // 8-bit is unsigned
+            else sum += (signed char) p[2 * c + 1];         // High byte of 16-bit
+        }
+        blocks[b][w + j] = (signed char) (sum / music.channels);
+    }
+    return got;
+}
+
+/**
+ * Fill buffer b from the file, starting over at the end if the music loops.
+ * Each read takes what fits behind the samples so far, so a file of wider
+ * frames takes a few reads, and the last MUSIC_TAIL bytes may stay unused.
+ * Returns the number of samples, 0 at the end of the music.
+ */
+#define MUSIC_TAIL 64
+static int read_block(int b)
+{
+    int w = 0;
+    while (MUSIC_BLOCK - w >= MUSIC_TAIL) {
+        if (!music.frames_left) {
+            if (!music.loop) break;
+            fseek(music.file, music.data_start, SEEK_SET);
+            music.frames_left = music.frames;
+        }
+        int got = read_frames(b, w);
+        if (!got) break;
+        w += got;
+    }
+    return w;
+}
+
+void music_update()
+{
+    PROFILE_SCOPE(PROFILE_MUSIC);
+    if (!music.file || !music.streaming) return;
+
+    for (int i = 0; i < 2 && !filled[music.writing]; i++) {
+        int got = read_block(music.writing);
+        if (!got) {
+            music.streaming = 0;    // The interrupt stops once it runs dry
+            return;
+        }
+        filled[music.writing] = got;
+        music.writing ^= 1;
+    }
+}
+
+int music_playing()
+{
+    return music.active;
+}
+
+unsigned int music_underruns()
+{
+    return music.underruns;
+}
+
+int music_sample()
+{
+    if (!music.active) return 0;
+
+    int count = filled[music.reading];
+    if (!count) {
+        if (music.streaming) music.underruns = music.underruns + 1;
+        else music.active = 0;
+        return 0;
+    }
+
+    int sample = blocks[music.reading][music.pos >> 16];
+    music.pos += music.step;
+    if ((int) (music.pos >> 16) >= count) {
+        music.pos -= (unsigned int) count << 16;
+        filled[music.reading] = 0;
+        music.reading ^= 1;
+    }
+    return sample * music.volume / 128;
+}
@@ -0,0 +1,59 @@
+#ifndef MUSIC_H
+#define MUSIC_H
+
+/**
+ * Background music, streamed from WAV files on the SD card into the audio
+ * mixer (see audio.h). The file is read a block at a time into one of two
+ * buffers by music_update, on the game loop, while the audio interrupt plays
+ * the other one, so the memory used does not depend on the length of the
+ * file and the interrupt never touches the card.
+ *
+ * Files are PCM, mono or stereo, 8 or 16 bits, at any rate; they are mixed
+ * down to 8-bit mono and played at AUDIO_RATE.
+ */
+
+/**
+ * Size of each of the two buffers, in samples (bytes). The interrupt plays
+ * one while music_update refills the other, so music_update may run late by
+ * the length of one buffer before the music skips: a quarter second for a
+ * file at 8 kHz, under 50 ms at 44.1 kHz.
+ */
+#define MUSIC_BLOCK 2048
+
+/**
+ * Start playing WORLD_ROOT/music/<name>.wav at volume (0 to
+ * AUDIO_MAX_VOLUME), from the start again when it ends if loop is nonzero.
+ * Stops any music playing. Returns 0, or -1 if the file is missing or not a
+ * WAV file this can play.
+ */
+int music_play(const char* name, int volume, int loop);
+
+/**
+ * Stop the music and close the file.
+ */
+void music_stop();
+
+/**
+ * Refill the buffers the interrupt has finished with. Call often, at least
+ * once per frame.
+ */
+void music_update();
+
+/**
+ * Returns nonzero while music plays (or waits for data).
+ */
+int music_playing();
+
+/**
+ * Samples of silence played since the music started because the next
+ * buffer was not ready, i.e. because music_update ran late.
+ */
+unsigned int music_underruns();
+
+/**
+ * For the audio interrupt: the next sample, in the same units as a voice's
+ * volume (see audio_play). Returns 0 while there is no data.
+ */
+int music_sample();
+
+#endif // MUSIC_H
@@ -0,0 +1,330 @@
+#include "path.h"
+#include "map.h"
+
+#include <string.h>
+
+/**
+ * The four moves, in the order neighbors are tried, with the bit
+ * map_blocked_neighbors uses for each.
+ */
+static const int step_dx[4] = { 0, 0, 1, -1 };
+static const int step_dy[4] = { -1, 1, 0, 0 };
+static const int step_bit[4] = { BLOCKED_N, BLOCKED_S, BLOCKED_E, BLOCKED_W };
+
+/**
+ * A* search state. A node is a cell the search has reached; nodes[0] is the
+ * start. Open nodes sit in a binary min-heap ordered by f, and slots maps a
+ * cell to its node through a small open addressing table, so the search never
+ * touches memory proportional to the map. All of it is reset, not freed, by
+ * the next search.
+ */
+#define PATH_SLOTS (PATH_MAX_NODES * 2)  // Power of two, at most half full
+#define NO_NODE 0xFFFF
+#define CLOSED  0xFFFF                   // heap_pos of nodes already expanded
+
+typedef struct {
+    short x, y;
+    unsigned short g;           // Steps from the start
+    unsigned short f;           // g plus the estimated steps left
+    unsigned short parent;      // Node this one was reached from
+    unsigned short heap_pos;    // Index in open_heap, or CLOSED
+} PathNode;
+
+static PathNode nodes[PATH_MAX_NODES];
+static int num_nodes;
+static unsigned short open_heap[PATH_MAX_NODES];
+static int open_size;
+static unsigned short slots[PATH_SLOTS];    // Node index + 1, 0 if free
+
+/**
+ * Manhattan distance: never more than the real number of steps, so the first
+ * path A* completes is a shortest one.
+ */
+static int estimate(int x, int y, int tx, int ty)
+{
+    return (x > tx ? x - tx : tx - x) + (y > ty ? y - ty : ty - y);
+}
+
+static unsigned int slot_of(int x, int y)
+{
+    unsigned int h = (unsigned int)x * 0x9E3779B1u ^ (unsigned int)y * 0x85EBCA77u;
+    return (h ^ (h >> 15)) & (PATH_SLOTS - 1);
+}
+
+/**
+ * Returns the node of (x,y), or NO_NODE if the search has not reached it.
+ * If slot is not NULL it receives where a new node for the cell would go.
+ */
+static int find_node(int x, int y, unsigned int* slot)
+{
+    unsigned int i = slot_of(x, y);
+    while (slots[i]) {
+        PathNode* node = &nodes[slots[i] - 1];
+        if (node->x == x && node->y == y) return slots[i] - 1;
+        i = (i + 1) & (PATH_SLOTS - 1);
+    }
+    if (slot) *slot = i;
+    return NO_NODE;
+}
+
+/**
+ * Heap order: lower f first; on equal f, the node further along (higher g),
+ * which keeps the search heading straight for the target.
+ */
+static int heap_less(int a, int b)
+{
+    if (nodes[a].f != nodes[b].f) return nodes[a].f < nodes[b].f;
+    return nodes[a].g > nodes[b].g;
+}
+
+static void heap_set(int pos, int n)
+{
+    open_heap[pos] = n;
+    nodes[n].heap_pos = pos;
+}
+
+static void sift_up(int pos)
+{
+    int n = open_heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!heap_less(n, open_heap[parent])) break;
+        heap_set(pos, open_heap[parent]);
+        pos = parent;
+    }
+    heap_set(pos, n);
+}
+
+static void sift_down(int pos)
+{
+    int n = open_heap[pos];
+    for (;;) {
+        int child = 2 * pos + 1;
+        if (child >= open_size) break;
+        if (child + 1 < open_size && heap_less(open_heap[child + 1], open_heap[child])) child++;
+        if (!heap_less(open_heap[child], n)) break;
+        heap_set(pos, open_heap[child]);
+        pos = child;
+    }
+    heap_set(pos, n);
+}
+
+static int pop_open()
+{
+    int n = open_heap[0];
+    if (--open_size > 0) {
+        open_heap[0] = open_heap[open_size];
+        sift_down(0);
+    }
+    nodes[n].heap_pos = CLOSED;
+    return n;
+}
+
+static void push_open(int n)
+{
+    open_heap[open_size] = n;
+    sift_up(open_size++);
+}
+
+/**
+ * Set *dx,*dy to the first step of the path from the start to node n.
+ */
+static void first_step(int n, int* dx, int* dy)
+{
+    *dx = *dy = 0;
+    if (n == 0) return;
+    while (nodes[n].parent != 0) n = nodes[n].parent;
+    *dx = nodes[n].x - nodes[0].x;
+    *dy = nodes[n].y - nodes[0].y;
+}
+
+int path_find(int sx, int sy, int tx, int ty, int* dx, int* dy)
+{
+    *dx = *dy = 0;
+    if (sx == tx && sy == ty) return 0;
+
+    memset(slots, 0, sizeof(slots));
+    unsigned int slot;
+    find_node(sx, sy, &slot);
+    slots[slot] = 1;
+    nodes[0].x = sx;
+    nodes[0].y = sy;
+    nodes[0].g = 0;
+    nodes[0].f = estimate(sx, sy, tx, ty);
+    nodes[0].parent = NO_NODE;
+    num_nodes = 1;
+    open_size = 0;
+    push_open(0);
+
+    int best = 0;   // Expanded node closest to the target
+    while (open_size) {
+        int n = pop_open();
+        int x = nodes[n].x, y = nodes[n].y;
+        if (x == tx && y == ty) {
+            first_step(n, dx, dy);
+            return nodes[n].g;
+        }
+        if (nodes[n].f - nodes[n].g < nodes[best].f - nodes[best].g) best = n;
+
+        int blocked = map_blocked_neighbors(x, y);
+        for (int d = 0; d < 4; d++) {
+            int nx = x + step_dx[d], ny = y + step_dy[d];
+            if ((blocked & step_bit[d]) && !(nx == tx && ny == ty)) continue;
+            int g = nodes[n].g + 1;
+            int m = find_node(nx, ny, &slot);
+            if (m == NO_NODE) {
+                if (num_nodes == PATH_MAX_NODES) continue; // Pool spent
+                m = num_nodes++;
+                slots[slot] = m + 1;
+                nodes[m].x = nx;
+                nodes[m].y = ny;
+                nodes[m].g = g;
+                nodes[m].f = g + estimate(nx, ny, tx, ty);
+                nodes[m].parent = n;
+                push_open(m);
+            } else if (nodes[m].heap_pos != CLOSED && g < nodes[m].g) {
+                // Shorter way to an open node. With a consistent estimate an
+                // expanded node is never improved, so closed ones are skipped.
+                nodes[m].f -= nodes[m].g - g;
+                nodes[m].g = g;
+                nodes[m].parent = n;
+                sift_up(nodes[m].heap_pos);
+            }
+        }
+    }
+    first_step(best, dx, dy);
+    return -1;
+}
+
+/**
+ * Flow field. Distances are one byte per cell of the window, FLOW_UNKNOWN
+ * where unknown; distances past 254 steps are clamped to 254. Two fields
+ * alternate: readers use ready while the sweep builds the other one, and the
+ * two swap when the sweep finishes. A target that moves during a sweep is
+ * picked up by the next one, so readers see a field at most one sweep behind
+ * the player.
+ */
+#define FLOW_CELLS (FLOW_SIZE * FLOW_SIZE)
+
+#if FLOW_SIZE > 32
+#error "FLOW_SIZE must be at most 32 (one map_blocked_row mask per window row)"
+#endif
+
+typedef struct {
+    unsigned char dist[FLOW_CELLS];
+    int x0, y0;         // Map cell of dist[0]
+    Map* map;           // Map the field was swept on
+} FlowField;
+
+static FlowField fields[2];
+static FlowField* ready;    // Last complete field; NULL before the first
+
+static struct {
+    FlowField* field;           // Field being swept, NULL when idle
+    int tx, ty;                 // Latest target
+    Map* map;                   // Map of the latest target
+    int pending;                // The field is behind the latest target
+    // Blocked cells of the window rows, as read when the sweep started
+    unsigned int rows[FLOW_SIZE];
+    // Breadth-first queue of window cells; each cell is queued at most once
+    unsigned short queue[FLOW_CELLS];
+    int head, tail;
+} flow;
+
+/**
+ * Start sweeping toward the latest target, into whichever field readers are
+ * not using.
+ */
+static void start_sweep()
+{
+    FlowField* field = ready == &fields[0] ? &fields[1] : &fields[0];
+    field->x0 = flow.tx - FLOW_SIZE / 2;
+    field->y0 = flow.ty - FLOW_SIZE / 2;
+    field->map = flow.map;
+    memset(field->dist, FLOW_UNKNOWN, sizeof(field->dist));
+    for (int j = 0; j < FLOW_SIZE; j++) {
+        flow.rows[j] = map_blocked_row(field->x0, field->y0 + j, FLOW_SIZE);
+    }
+
+    // The target is the seed even when it stands in a wall
+    int seed = (FLOW_SIZE / 2) * FLOW_SIZE + FLOW_SIZE / 2;
+    field->dist[seed] = 0;
+    flow.queue[0] = seed;
+    flow.head = 0;
+    flow.tail = 1;
+    flow.field = field;
+    flow.pending = 0;
+}
+
+void flow_set_target(int x, int y)
+{
+    Map* map = get_active_map();
+    if (flow.map == map && flow.tx == x && flow.ty == y) return;
+    flow.tx = x;
+    flow.ty = y;
+    flow.map = map;
+    flow.pending = 1;
+}
+
+void flow_invalidate()
+{
+    flow.pending = 1;
+}
+
+int flow_update(int budget)
+{
+    // A sweep in progress runs to the end even if the target moved on, so a
+    // target that moves every call still gets fields; only a sweep of a map
+    // that is no longer active is dropped
+    if (flow.field && flow.field->map != flow.map) flow.field = NULL;
+    if (!flow.field) {
+        if (!flow.pending) return 0;
+        start_sweep();
+    }
+
+    FlowField* field = flow.field;
+    for (; budget > 0 && flow.head < flow.tail; budget--) {
+        int cell = flow.queue[flow.head++];
+        int cx = cell % FLOW_SIZE, cy = cell / FLOW_SIZE;
+        int d = field->dist[cell] + 1;
+        if (d >= FLOW_UNKNOWN) d = FLOW_UNKNOWN - 1;
+        for (int k = 0; k < 4; k++) {
+            int nx = cx + step_dx[k], ny = cy + step_dy[k];
+            if (nx < 0 || ny < 0 || nx >= FLOW_SIZE || ny >= FLOW_SIZE) continue;
+            if ((flow.rows[ny] >> nx) & 1) continue;
+            int next = ny * FLOW_SIZE + nx;
+            if (field->dist[next] != FLOW_UNKNOWN) continue;
+            field->dist[next] = d;
+            flow.queue[flow.tail++] = next;
+        }
+    }
+    if (flow.head < flow.tail) return 1;
+
+    ready = field;
+    flow.field = NULL;
+    return flow.pending;
+}
+
+int flow_distance(int x, int y)
+{
+    if (!ready || ready->map != get_active_map()) return FLOW_UNKNOWN;
+    x -= ready->x0;
+    y -= ready->y0;
+    if (x < 0 || y < 0 || x >= FLOW_SIZE || y >= FLOW_SIZE) return FLOW_UNKNOWN;
+    return ready->dist[y * FLOW_SIZE + x];
+}
+
+int flow_step(int x, int y, int* dx, int* dy)
+{
+    int best = FLOW_UNKNOWN;
+    *dx = *dy = 0;
+    for (int d = 0; d < 4; d++) {
+        int dist = flow_distance(x + step_dx[d], y + step_dy[d]);
+        if (dist < best) {
+            best = dist;
+            *dx = step_dx[d];
+            *dy = step_dy[d];
+        }
+    }
+    return best;
+}
@@ -0,0 +1,82 @@
+#ifndef PATH_H
+#define PATH_H
+
+/**
+ * Pathfinding over the active map for the mobile enemies. A cell is an
+ * obstacle when map_blocked says so, and every move is one step north, south,
+ * east or west.
+ *
+ * There are two services:
+ *  - path_find runs A* between two cells. The node pool, the open-set heap
+ *    and the cell index are preallocated and reused by every search, so a
+ *    search allocates nothing and expands at most PATH_MAX_NODES cells.
+ *  - The flow field keeps the walking distance to one target (the player)
+ *    for every cell of a FLOW_SIZE x FLOW_SIZE window around it, so any number
+ *    of enemies in the window find their next step with four lookups. When
+ *    the target moves, flow_update sweeps a new field a bounded number of
+ *    cells per call while readers keep using the last complete one.
+ */
+
+/**
+ * The most cells one path_find call expands. Searches that need more give
+ * up and step toward the closest cell they reached.
+ */
+#define PATH_MAX_NODES 256
+
+/**
+ * Find a path from (sx,sy) to (tx,ty). The start and target cells themselves
+ * may be blocked (an enemy searching toward the player stands on its own
+ * blocked tile). Sets *dx,*dy to the first step of the path and returns its
+ * length in steps. If there is no path within PATH_MAX_NODES expansions,
+ * returns -1 and sets *dx,*dy to the first step toward the explored cell
+ * closest to the target (0,0 if there is none).
+ */
+int path_find(int sx, int sy, int tx, int ty, int* dx, int* dy);
+
+/**
+ * Side of the flow field window, in tiles. At most 32: the sweep reads each
+ * window row as one map_blocked_row mask.
+ */
+#define FLOW_SIZE 32
+
+/**
+ * Distance of cells the flow field knows nothing about: outside the window,
+ * unreachable, or before the first sweep completes.
+ */
+#define FLOW_UNKNOWN 255
+
+/**
+ * Point the flow field at (x,y) on the active map. The next flow_update that
+ * finds no sweep in progress starts one toward the latest target; switching
+ * maps drops a sweep of the old map.
+ */
+void flow_set_target(int x, int y);
+
+/**
+ * Sweep again even if the target has not moved, e.g. after walls changed.
+ * The map calls this itself when add_tile, add_stairs or map_erase change
+ * whether a cell of the active map can be walked on.
+ */
+void flow_invalidate();
+
+/**
+ * Continue the sweep, visiting at most budget cells. When it finishes the new
+ * field replaces the one readers see. Returns nonzero while the field is
+ * still behind the latest target.
+ */
+int flow_update(int budget);
+
+/**
+ * Steps from (x,y) to the target in the last complete field, or FLOW_UNKNOWN.
+ * Blocked cells have no distance of their own.
+ */
+int flow_distance(int x, int y);
+
+/**
+ * Pick the neighbor of (x,y) closest to the target: sets *dx,*dy to the step
+ * toward it and returns its distance (0 when the target is next to (x,y)).
+ * Returns FLOW_UNKNOWN, with *dx,*dy 0, if no neighbor has a distance.
+ */
+int flow_step(int x, int y, int* dx, int* dy);
+
+#endif // PATH_H
@@ -0,0 +1,138 @@
+#include "pool.h"
+
+#include <stdlib.h>   // For malloc and free
+
+/**
+ * A slab header. The items of the slab follow it directly in memory. The
+ * union pads the header so the items that follow are suitably aligned.
+ */
+typedef union _Slab {
+  struct {
+    /** The next (older) slab of the pool */
+    union _Slab* next;
+
+    /** One past the last byte of this slab's items */
+    char* end;
+  } hdr;
+  double align;
+  void* align_ptr;
+} Slab;
+
+/**
+ * The strictest alignment an item needs: that of the widest basic types.
+ * Item sizes are rounded up to a multiple of it.
+ */
+typedef union {
+  double d;
+  long l;
+  void* p;
+} PoolAlign;
+
+/**
+ * A freed item. While an item sits on the free list its first bytes hold the
+ * pointer to the next free item.
+ */
+typedef struct _FreeItem {
+  struct _FreeItem* next;
+} FreeItem;
+
+struct _Pool {
+  /** The most recently allocated slab; older slabs hang off its hdr.next */
+  Slab* slabs;
+
+  /** Items that were freed and can be handed out again */
+  FreeItem* free_list;
+
+  /** The next never-used item of the newest slab, and the end of that slab */
+  char* bump;
+  char* bump_end;
+
+  /** The lowest and one past the highest address of any slab, so poolOwns
+   *  turns most foreign pointers away without walking the slabs */
+  const char* lo;
+  const char* hi;
+
+  /** The size of one item (rounded up for alignment) */
+  unsigned int item_size;
+
+  /** The number of items per slab */
+  unsigned int items_per_slab;
+};
+
+Pool* createPool(unsigned int itemSize, unsigned int itemsPerSlab) {
+  Pool* pool = (Pool*)malloc(sizeof(Pool));
+  if (!pool) return NULL;
+
+  // Every item must be able to hold a free list link, and keep the items of a
+  // slab aligned for any basic type
+  if (itemSize < sizeof(FreeItem)) itemSize = sizeof(FreeItem);
+  itemSize = (itemSize + sizeof(PoolAlign) - 1) / sizeof(PoolAlign) * sizeof(PoolAlign);
+
+  pool->slabs = NULL;
+  pool->lo = NULL;
+  pool->hi = NULL;
+  pool->free_list = NULL;
+  pool->bump = NULL;
+  pool->bump_end = NULL;
+  pool->item_size = itemSize;
+  pool->items_per_slab = itemsPerSlab ? itemsPerSlab : 1;
+  return pool;
+}
+
+void destroyPool(Pool* pool) {
+  // Items are never freed on their own; releasing the slabs releases them all
+  Slab* slab = pool->slabs;
+  while (slab) {
+    Slab* next = slab->hdr.next;
+    free(slab);
+    slab = next;
+  }
+  free(pool);
+}
+
+void* poolAlloc(Pool* pool) {
+  // Reuse a freed item first
+  if (pool->free_list) {
+    FreeItem* item = pool->free_list;
+    pool->free_list = item->next;
+    return item;
+  }
+
+  // Otherwise carve the next item out of the newest slab, adding a slab when
+  // it is used up
+  if (pool->bump == pool->bump_end) {
+    unsigned int bytes = pool->item_size * pool->items_per_slab;
+    Slab* slab = (Slab*)malloc(sizeof(Slab) + bytes);
+    if (!slab) return NULL;
+    slab->hdr.next = pool->slabs;
+    slab->hdr.end = (char*)(slab + 1) + bytes;
+    pool->slabs = slab;
+    pool->bump = (char*)(slab + 1);
+    pool->bump_end = slab->hdr.end;
+    if (!pool->lo || (const char*)(slab + 1) < pool->lo) pool->lo = (const char*)(slab + 1);
+    if (!pool->hi || slab->hdr.end > pool->hi) pool->hi = slab->hdr.end;
+  }
+  void* item = pool->bump;
+  pool->bump += pool->item_size;
+  return item;
+}
+
+void poolFree(Pool* pool, void* item) {
+  if (!item) return;
+  FreeItem* freed = (FreeItem*)item;
+  freed->next = pool->free_list;
+  pool->free_list = freed;
+}
+
+int poolOwns(Pool* pool, const void* item) {
+  const char* p = (const char*)item;
+  if (p < pool->lo || p >= pool->hi) return 0;
+
+  // Other heap blocks can lie between two slabs, so find the slab itself and
+  // check that the pointer is the start of one of its items
+  for (Slab* slab = pool->slabs; slab; slab = slab->hdr.next) {
+    const char* first = (const char*)(slab + 1);
+    if (p >= first && p < slab->hdr.end) return (p - first) % pool->item_size == 0;
+  }
+  return 0;
+}
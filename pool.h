@@ -0,0 +1,72 @@
+/****************************************************************************
+ * Fixed-size slab allocator
+ *
+ * A Pool hands out items of one fixed size from big blocks ("slabs") instead
+ * of calling malloc for every item. Freed items go on a free list and are
+ * reused first, so a long session does not fragment the heap, and the whole
+ * pool is released at once by freeing its slabs.
+ ***************************************************************************/
+#ifndef POOL_H
+#define POOL_H
+
+/**
+ * This defines a type that is a _Pool struct. The definition for _Pool is
+ * implemented in pool.cpp.
+ */
+typedef struct _Pool Pool;
+
+/**
+ * createPool
+ *
+ * Creates an empty pool. No slab is allocated until the first poolAlloc.
+ *
+ * @param itemSize The size in bytes of every item handed out by the pool.
+ * @param itemsPerSlab How many items each slab holds.
+ * @return a pointer to the new pool
+ */
+Pool* createPool(unsigned int itemSize, unsigned int itemsPerSlab);
+
+/**
+ * destroyPool
+ *
+ * Free every slab of the pool, and the pool itself. All items handed out by
+ * the pool become invalid; they do not have to be freed one by one first.
+ *
+ * @param pool The pointer to the pool.
+ */
+void destroyPool(Pool* pool);
+
+/**
+ * poolAlloc
+ *
+ * Get an item from the pool. The contents are not initialized.
+ *
+ * @param pool The pointer to the pool.
+ * @return a pointer to the item, or NULL if a new slab could not be allocated
+ */
+void* poolAlloc(Pool* pool);
+
+/**
+ * poolFree
+ *
+ * Return an item to the pool so a later poolAlloc can reuse it.
+ *
+ * @param pool The pointer to the pool.
+ * @param item An item that was handed out by this pool.
+ */
+void poolFree(Pool* pool, void* item);
+
+/**
+ * poolOwns
+ *
+ * Check whether a pointer is an item of the pool: the start of an item in
+ * one of its slabs. Pointers outside the range of addresses the slabs span
+ * are turned away with two comparisons; others cost a walk of the slabs.
+ *
+ * @param pool The pointer to the pool.
+ * @param item The pointer to check.
+ * @return nonzero if the item belongs to this pool
+ */
+int poolOwns(Pool* pool, const void* item);
+
+#endif // POOL_H
@@ -0,0 +1,150 @@
+#include "profile.h"
+#include "globals.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define PURPLE 0x800080
+
+static const char* const names[PROFILE_SECTIONS] = {
+    "frame", "read_inputs", "get_action", "update_game",
+    "draw_game", "blit", "status", "music"
+};
+
+static struct {
+    unsigned int count;
+    unsigned long long total;
+    unsigned int min, max;
+    unsigned int last;                      // The latest time, for the overlay
+    unsigned short buckets[PROFILE_BUCKETS];
+} sections[PROFILE_SECTIONS];
+
+static unsigned int window_start;           // When the report period began
+
+static struct {
+    int on;
+    int shown;                              // Whether it is on the screen
+    unsigned int drawn;                     // When it was last drawn
+} overlay;
+
+/**
+ * Bucket of a time: exact below 4, then four per power of two.
+ */
+static int bucket_of(unsigned int us)
+{
+    if (us < 4) return us;
+    int e = 2;
+    while (e < 31 && (us >> (e + 1))) e++;
+    int b = 4 * (e - 1) + ((us >> (e - 2)) & 3);
+    return b < PROFILE_BUCKETS ? b : PROFILE_BUCKETS - 1;
+}
+
+/**
+ * Smallest time in bucket b.
+ */
+static unsigned int bucket_floor(int b)
+{
+    if (b < 4) return b;
+    return (unsigned int) (4 + b % 4) << (b / 4 - 1);
+}
+
+void profile_record(int section, unsigned int us)
+{
+    if (section < 0 || section >= PROFILE_SECTIONS) return;
+    if (!window_start) window_start = us_ticker_read();
+
+    if (!sections[section].count || us < sections[section].min) sections[section].min = us;
+    if (us > sections[section].max) sections[section].max = us;
+    sections[section].count++;
+    sections[section].total += us;
+    sections[section].last = us;
+    unsigned short* n = &sections[section].buckets[bucket_of(us)];
+    if (*n < 0xFFFF) (*n)++;
+}
+
+ProfileScope::ProfileScope(int section) : section(section), start(us_ticker_read())
+{
+}
+
+ProfileScope::~ProfileScope()
+{
+    profile_record(section, us_ticker_read() - start);
+}
+
+/**
+ * The 99th percentile of a section: the top of the bucket the 99th
+ * percentile sample falls in, but no more than the max.
+ */
+static unsigned int p99(int s)
+{
+    unsigned int want = sections[s].count - sections[s].count / 100, seen = 0;
+    for (int b = 0; b < PROFILE_BUCKETS; b++) {
+        seen += sections[s].buckets[b];
+        if (seen >= want) {
+            unsigned int top = b + 1 < PROFILE_BUCKETS ? bucket_floor(b + 1) - 1 : sections[s].max;
+            return top < sections[s].max ? top : sections[s].max;
+        }
+    }
+    return sections[s].max;
+}
+
+void profile_print()
+{
+    unsigned int now = us_ticker_read();
+    pc.printf("profile: %u ms, times in us\r\n", (now - window_start) / 1000);
+    pc.printf("%-12s %7s %7s %7s %7s %7s\r\n", "section", "count", "min", "avg", "max", "p99");
+    for (int s = 0; s < PROFILE_SECTIONS; s++) {
+        if (!sections[s].count) continue;
+        pc.printf("%-12s %7u %7u %7u %7u %7u\r\n", names[s], sections[s].count, sections[s].min,
+                  (unsigned int) (sections[s].total / sections[s].count), sections[s].max, p99(s));
+    }
+
+    for (int s = 0; s < PROFILE_SECTIONS; s++) {
+        unsigned int last = sections[s].last;
+        memset(&sections[s], 0, sizeof(sections[s]));
+        sections[s].last = last;
+    }
+    window_start = now;
+}
+
+/**
+ * Write us as milliseconds into text (8 bytes), to a tenth below 10 ms.
+ */
+static void format_ms(char* text, unsigned int us)
+{
+    if (us < 10000) snprintf(text, 8, "%u.%u", us / 1000, us / 100 % 10);
+    else snprintf(text, 8, "%u", us / 1000);
+}
+
+void profile_overlay(int on)
+{
+    overlay.on = on;
+}
+
+int profile_overlay_on()
+{
+    return overlay.on;
+}
+
+void profile_draw_overlay(int status_bar)
+{
+    // The right half of the lower status bar, clear of the XP
+    int background = status_bar ? PURPLE : BLACK;
+    if (!overlay.on) {
+        if (overlay.shown) uLCD.filled_rectangle(63, 119, 127, 127, background);
+        overlay.shown = 0;
+        return;
+    }
+
+    unsigned int now = us_ticker_read();
+    if (overlay.shown && now - overlay.drawn < PROFILE_OVERLAY_US) return;
+    overlay.shown = 1;
+    overlay.drawn = now;
+    uLCD.filled_rectangle(63, 119, 127, 127, background);
+    uLCD.textbackground_color(background);
+    uLCD.locate(9, 15);
+    char frame[8], draw[8];
+    format_ms(frame, sections[PROFILE_FRAME].last);
+    format_ms(draw, sections[PROFILE_DRAW_GAME].last);
+    uLCD.printf("F%s D%s", frame, draw);
+}
@@ -0,0 +1,77 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+ * Timing of the parts of a frame. Each section collects how long it took
+ * every time it ran into a histogram, from which profile_print reports the
+ * count, min, average, max and 99th percentile over the time since the last
+ * report. Time comes from the microsecond ticker, so a sample costs two reads
+ * of it and a few adds.
+ *
+ * A section is timed by putting PROFILE_SCOPE(section) at the top of a
+ * block: the time until the block ends is recorded.
+ */
+
+// Sections
+#define PROFILE_FRAME       0   // A pass of the game loop that draws
+#define PROFILE_READ_INPUTS 1
+#define PROFILE_GET_ACTION  2
+#define PROFILE_UPDATE_GAME 3
+#define PROFILE_DRAW_GAME   4
+#define PROFILE_BLIT        5   // One burst of tiles sent to the LCD
+#define PROFILE_STATUS      6   // Status bars sent to the LCD
+#define PROFILE_MUSIC       7   // Refilling the music buffers from the card
+#define PROFILE_SECTIONS    8
+
+/**
+ * Histogram buckets: four per power of two, exact below 4 us, up to about
+ * four seconds (longer times land in the last bucket). Percentiles are the
+ * upper edge of their bucket, so they read up to a quarter high.
+ */
+#define PROFILE_BUCKETS 88
+
+/**
+ * How often the overlay (see profile_overlay) is refreshed.
+ */
+#define PROFILE_OVERLAY_US 1000000
+
+/**
+ * Record that section took us microseconds.
+ */
+void profile_record(int section, unsigned int us);
+
+/**
+ * Times the rest of the enclosing block as section.
+ */
+class ProfileScope {
+public:
+    ProfileScope(int section);
+    ~ProfileScope();
+private:
+    int section;
+    unsigned int start;
+};
+
+#define PROFILE_SCOPE(section) ProfileScope profile_scope(section)
+
+/**
+ * Print a table of every section that ran to the serial console, then start
+ * over.
+ */
+void profile_print();
+
+/**
+ * Show (nonzero) or hide the overlay: the last frame and draw_game times, in
+ * milliseconds, at the right of the lower status bar, e.g. "F6.7 D6.6".
+ */
+void profile_overlay(int on);
+int profile_overlay_on();
+
+/**
+ * Draw the overlay if it is due, or erase it once it has been hidden. Call
+ * once per frame, after the status bars; status_bar is nonzero if the lower
+ * status bar is shown, so the overlay matches it, and zero to draw on black.
+ */
+void profile_draw_overlay(int status_bar);
+
+#endif // PROFILE_H
@@ -0,0 +1,25 @@
+#ifndef SIM_MMA8452_H
+#define SIM_MMA8452_H
+
+/*
+ * Host stand-in for the MMA8452 accelerometer library. Readings come from the
+ * simulator's input script (see sim.h), and each read advances simulated time
+ * by its modeled I2C bus time at the given frequency.
+ */
+
+#include "mbed.h"
+
+class MMA8452 {
+public:
+    MMA8452(PinName sda, PinName scl, int frequency) : _frequency(frequency) {}
+
+    int readXGravity(double* x);
+    int readYGravity(double* y);
+    int readZGravity(double* z);
+    int readXYZGravity(double* x, double* y, double* z);
+
+private:
+    int _frequency;
+};
+
+#endif // SIM_MMA8452_H
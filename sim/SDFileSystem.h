@@ -0,0 +1,16 @@
+#ifndef SIM_SDFILESYSTEM_H
+#define SIM_SDFILESYSTEM_H
+
+/*
+ * Host stand-in for SDFileSystem. There is nothing to mount: the game reaches
+ * the card through WORLD_ROOT, which sim/Makefile points at a host directory.
+ */
+
+#include "mbed.h"
+
+class SDFileSystem {
+public:
+    SDFileSystem(PinName mosi, PinName miso, PinName sclk, PinName cs, const char* name) {}
+};
+
+#endif // SIM_SDFILESYSTEM_H
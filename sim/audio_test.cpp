@@ -0,0 +1,175 @@
+/*
+ * audio_test: the sound mixer (audio.cpp) on the host, checked through the
+ * samples it writes to the DAC (audio_capture). Run with
+ *
+ *      make -C sim test
+ *
+ * The simulator runs the audio ticker while the test waits, so every check
+ * plays a sound, waits for it to end and then looks at what came out. Prints
+ * each failed check and exits nonzero if there was one.
+ */
+#include "globals.h"
+#include "audio.h"
+
+#include <stdio.h>
+
+#define SILENCE 32768
+#define CAPTURE 2048
+#define VOLUME 100
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+static unsigned short samples[CAPTURE];
+
+/**
+ * A pickup-like effect whose waves fit the sample rate exactly: 1000 Hz is 8
+ * samples a period, 500 Hz 16, and 10 ms is 80 samples.
+ */
+static const Tone effect[] = { {1000, 10}, {0, 5}, {500, 20}, {0, 0} };
+#define EFFECT_SAMPLES (80 + 40 + 160)
+
+static const Tone beep[] = { {1000, 10}, {0, 0} };
+static const Tone half[] = { {500, 1}, {0, 0} };   // Stops half way up a period
+
+/**
+ * Capture everything the mixer writes while tones play at volume, together
+ * with more at more_volume if more is not NULL, until they end. Returns the
+ * number of samples.
+ */
+static int capture(const Tone* tones, int volume, const Tone* more, int more_volume)
+{
+    audio_capture(samples, CAPTURE);
+    CHECK(audio_play(tones, volume) >= 0);
+    if (more) CHECK(audio_play(more, more_volume) >= 0);
+    wait_us(1000000);
+    int n = audio_captured();
+    audio_capture(NULL, 0);
+    return n;
+}
+
+/**
+ * The sample a square wave of the given period (in samples) and amplitude
+ * has at sample i of its tone, starting low.
+ */
+static int square(int i, int period, int amplitude)
+{
+    return SILENCE + (i % period < period / 2 ? -amplitude : amplitude);
+}
+
+/**
+ * Count the samples from first to first + n that differ from the square
+ * wave.
+ */
+static int off_square(int first, int n, int period, int amplitude)
+{
+    int wrong = 0;
+    for (int i = 0; i < n; i++) wrong += samples[first + i] != square(i, period, amplitude);
+    return wrong;
+}
+
+/**
+ * The tones play in order at their pitch and length, with silence for the
+ * pause, and the ticker writes one last silent sample and stops.
+ */
+static void test_effect()
+{
+    int n = capture(effect, VOLUME, NULL, 0);
+    CHECK(n == EFFECT_SAMPLES + 1);
+    CHECK(audio_playing() == 0);
+    if (n < EFFECT_SAMPLES + 1) return;
+
+    int amplitude = SILENCE - samples[0];
+    CHECK(amplitude > 0);
+    CHECK(off_square(0, 80, 8, amplitude) == 0);
+    int pause = 0;
+    for (int i = 80; i < 120; i++) pause += samples[i] != SILENCE;
+    CHECK(pause == 0);
+    CHECK(off_square(120, 160, 16, amplitude) == 0);
+    CHECK(samples[EFFECT_SAMPLES] == SILENCE);
+
+    // Twice the volume is twice the amplitude
+    CHECK(capture(effect, 2 * VOLUME, NULL, 0) == EFFECT_SAMPLES + 1);
+    CHECK(off_square(0, 80, 8, 2 * amplitude) == 0);
+
+    // A sound starts at the start of its wave whatever the voice played last
+    CHECK(capture(half, VOLUME, NULL, 0) == 9);
+    CHECK(capture(beep, VOLUME, NULL, 0) == 81);
+    CHECK(off_square(0, 80, 8, amplitude) == 0);
+
+    // Once stopped, the ticker stays stopped
+    audio_capture(samples, CAPTURE);
+    wait_us(100000);
+    CHECK(audio_captured() == 0);
+    audio_capture(NULL, 0);
+}
+
+/**
+ * Voices playing at once add up, and all of them at full volume still fit
+ * the DAC.
+ */
+static void test_mixing()
+{
+    CHECK(capture(beep, VOLUME + VOLUME / 2, NULL, 0) == 81);
+    int amplitude = SILENCE - samples[0];
+    CHECK(amplitude > 0);
+
+    CHECK(capture(beep, VOLUME, beep, VOLUME / 2) == 81);
+    CHECK(off_square(0, 80, 8, amplitude) == 0);
+
+    CHECK(capture(beep, AUDIO_MAX_VOLUME, NULL, 0) == 81);
+    int full = SILENCE - samples[0];
+    for (int v = 0; v < AUDIO_VOICES; v++) CHECK(audio_play(beep, AUDIO_MAX_VOLUME) == v);
+    audio_capture(samples, CAPTURE);
+    wait_us(1000000);
+    CHECK(audio_captured() == 81);
+    CHECK(off_square(0, 80, 8, AUDIO_VOICES * full) == 0);
+    audio_capture(NULL, 0);
+}
+
+/**
+ * A sound started while every voice is busy is dropped, and audio_stop ends
+ * them all.
+ */
+static void test_voices()
+{
+    for (int v = 0; v < AUDIO_VOICES; v++) CHECK(audio_play(effect, VOLUME) == v);
+    CHECK(audio_play(effect, VOLUME) == -1);
+    CHECK(audio_playing() == AUDIO_VOICES);
+
+    audio_capture(samples, CAPTURE);
+    wait_us(1000);
+    audio_stop();
+    CHECK(audio_playing() == 0);
+    wait_us(1000);
+    int n = audio_captured();
+    CHECK(n > 0 && samples[n - 1] == SILENCE);
+    wait_us(100000);
+    CHECK(audio_captured() == n);
+    audio_capture(NULL, 0);
+
+    // The voices are free again
+    CHECK(audio_play(beep, VOLUME) == 0);
+    audio_stop();
+}
+
+int main()
+{
+    audio_init();
+    test_effect();
+    test_mixing();
+    test_voices();
+
+    if (failures) {
+        printf("audio_test: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("audio_test: ok\n");
+    return 0;
+}
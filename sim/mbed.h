@@ -0,0 +1,139 @@
+#ifndef SIM_MBED_H
+#define SIM_MBED_H
+
+/*
+ * Host stand-in for the parts of the mbed 2 API the game uses. Only built by
+ * sim/Makefile; the real mbed.h is used on the board. Time is simulated (see
+ * sim.h): waits advance the clock instead of sleeping, so a scripted run takes
+ * as long as the game's CPU work plus modeled LCD traffic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include "sim.h"
+
+typedef enum {
+    p5 = 5, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17, p18, p19,
+    p20, p21, p22, p23, p24, p25, p26, p27, p28, p29, p30,
+    LED1 = 100, LED2, LED3, LED4,
+    USBTX, USBRX,
+    NC = -1
+} PinName;
+
+typedef enum { PullUp, PullDown, PullNone, OpenDrain } PinMode;
+
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+
+class Serial {
+public:
+    Serial(PinName tx, PinName rx) {}
+    void baud(int rate) {}
+    int putc(int c);
+    int printf(const char* format, ...);
+};
+
+class DigitalIn {
+public:
+    DigitalIn(PinName pin) : _pin(pin) {}
+    void mode(PinMode pull) {}
+    int read() { return sim_pin_read(_pin); }
+    operator int() { return read(); }
+private:
+    PinName _pin;
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin) : _pin(pin), _value(0) {}
+    void write(int value) { _value = value; sim_pin_write(_pin, value); }
+    int read() { return _value; }
+    DigitalOut& operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+private:
+    PinName _pin;
+    int _value;
+};
+
+class AnalogOut {
+public:
+    AnalogOut(PinName pin) : _value(0) {}
+    void write(float value) { _value = value; }
+    void write_u16(unsigned short value) { _value = value / 65535.0f; }
+    float read() { return _value; }
+    AnalogOut& operator=(float value) { write(value); return *this; }
+    operator float() { return read(); }
+private:
+    float _value;
+};
+
+class PwmOut {
+public:
+    PwmOut(PinName pin) : _value(0) {}
+    void write(float value) { _value = value; }
+    float read() { return _value; }
+    void period(float seconds) {}
+    void period_ms(int ms) {}
+    void period_us(int us) {}
+    PwmOut& operator=(float value) { write(value); return *this; }
+    operator float() { return read(); }
+private:
+    float _value;
+};
+
+class Timer {
+public:
+    Timer() : _running(0), _start(0), _total(0) {}
+    void start() { if (!_running) { _start = sim_time_us(); _running = 1; } }
+    void stop() { _total = elapsed(); _running = 0; }
+    void reset() { _total = 0; _start = sim_time_us(); }
+    int read_us() { return (int) elapsed(); }
+    int read_ms() { return (int) (elapsed() / 1000); }
+    float read() { return elapsed() / 1000000.0f; }
+    operator float() { return read(); }
+private:
+    uint64_t elapsed() { return _total + (_running ? sim_time_us() - _start : 0); }
+    int _running;
+    uint64_t _start, _total;
+};
+
+class InterruptIn {
+public:
+    InterruptIn(PinName pin) : _pin(pin), _rise(NULL), _fall(NULL) {}
+    void mode(PinMode pull) {}
+    int read() { return sim_pin_read(_pin); }
+    operator int() { return read(); }
+    void rise(void (*fn)()) { _rise = fn; sim_edge_attach(_pin, _rise, _fall); }
+    void fall(void (*fn)()) { _fall = fn; sim_edge_attach(_pin, _rise, _fall); }
+private:
+    PinName _pin;
+    void (*_rise)();
+    void (*_fall)();
+};
+
+class Ticker {
+public:
+    Ticker() : _slot(-1), _repeat(1) {}
+    ~Ticker() { detach(); }
+    void attach(void (*fn)(), float t) { attach_us(fn, (unsigned) (t * 1000000)); }
+    void attach_us(void (*fn)(), unsigned us) { _slot = sim_timer_attach(_slot, fn, us, _repeat); }
+    void detach() { sim_timer_detach(_slot); _slot = -1; }
+protected:
+    int _slot;
+    int _repeat;
+};
+
+class Timeout : public Ticker {
+public:
+    Timeout() { _repeat = 0; }
+};
+
+inline uint32_t us_ticker_read() { return (uint32_t) sim_time_us(); }
+
+#endif // SIM_MBED_H
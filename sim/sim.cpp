@@ -0,0 +1,625 @@
+/*
+ * The host simulator: simulated clock, scripted inputs, the in-memory LCD and
+ * the stand-in hardware classes declared in this directory's headers.
+ */
+#include "mbed.h"
+#include "uLCD_4DGL.h"
+#include "MMA8452.h"
+#include "SDFileSystem.h"
+#include "wave_player.h"
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * One scripted step: inputs held for ms milliseconds of simulated time.
+ */
+typedef struct {
+    unsigned ms;
+    int b1, b2, b3;
+    double ax, ay, az;
+} SimStep;
+
+static struct {
+    int ready;
+    uint64_t host_start_ns;     // Host monotonic clock at start
+    uint64_t virtual_us;        // Time advanced without using the CPU
+    SimStep* steps;
+    int num_steps;
+    uint64_t script_us;         // Total length of the script, 0 if none
+    int lcd_baud;
+    int verbose;
+    SimStats stats;
+    unsigned short lcd[SIM_LCD_SIZE * SIM_LCD_SIZE];
+    uint64_t serviced_us;       // Interrupts are delivered up to this time
+    int in_irq;                 // Whether a handler is running
+    uint64_t irq_us;            // The time the running handler was due
+} sim;
+
+/**
+ * Registered interrupt handlers (see sim_edge_attach, sim_timer_attach).
+ */
+static struct {
+    int pin;
+    void (*rise)();
+    void (*fall)();
+    int level;                  // Level when last delivered
+} edges[SIM_MAX_EDGES];
+static int num_edges;
+
+static struct {
+    void (*fn)();
+    uint64_t due;
+    unsigned period;            // Zero for a one-shot timer
+    int used;                   // Slot taken
+    int armed;                  // Due to run
+} timers[SIM_MAX_TIMERS];
+
+static uint64_t host_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void on_timeout(int sig)
+{
+    fprintf(stderr, "sim: timeout\n");
+    sim_finish();
+}
+
+/**
+ * Parse the script file at path into sim.steps. Exits on a malformed line.
+ */
+static void load_script(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "sim: cannot open script %s\n", path);
+        exit(1);
+    }
+    char line[256];
+    int capacity = 0, line_no = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_no++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        SimStep step;
+        int n = sscanf(line, "%u %d %d %d %lf %lf %lf", &step.ms, &step.b1, &step.b2,
+                       &step.b3, &step.ax, &step.ay, &step.az);
+        if (n <= 0) continue; // Blank or comment
+        if (n != 7) {
+            fprintf(stderr, "sim: %s:%d: expected ms b1 b2 b3 ax ay az\n", path, line_no);
+            exit(1);
+        }
+        if (sim.num_steps == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            sim.steps = (SimStep*) realloc(sim.steps, capacity * sizeof(SimStep));
+        }
+        sim.steps[sim.num_steps++] = step;
+        sim.script_us += step.ms * 1000ull;
+    }
+    fclose(file);
+}
+
+static void sim_init()
+{
+    if (sim.ready) return;
+    sim.ready = 1;
+    sim.host_start_ns = host_ns();
+    sim.lcd_baud = 9600; // The display's power-on rate
+
+    const char* script = getenv("SIM_SCRIPT");
+    if (script) load_script(script);
+    sim.verbose = getenv("SIM_VERBOSE") != NULL;
+
+    const char* timeout = getenv("SIM_TIMEOUT");
+    signal(SIGALRM, on_timeout);
+    alarm(timeout ? atoi(timeout) : 60);
+}
+
+/**
+ * The script step in effect at time t, or NULL without a script.
+ */
+static SimStep* step_at(uint64_t t)
+{
+    if (!sim.num_steps) return NULL;
+    for (int i = 0; i < sim.num_steps; i++) {
+        uint64_t ms = sim.steps[i].ms;
+        if (t < ms * 1000) return &sim.steps[i];
+        t -= ms * 1000;
+    }
+    return &sim.steps[sim.num_steps - 1];
+}
+
+/**
+ * The script step in effect now, or NULL without a script. Ends the run once
+ * the script is over.
+ */
+static SimStep* current_step()
+{
+    uint64_t now = sim_time_us();   // Also delivers the interrupts due
+    if (!sim.num_steps) return NULL;
+    if (now >= sim.script_us) sim_finish();
+    return step_at(now);
+}
+
+static int level_at(int pin, uint64_t t)
+{
+    SimStep* step = step_at(t);
+    if (!step) return 1;
+    switch (pin) {
+        case p21: return step->b1;
+        case p22: return step->b2;
+        case p23: return step->b3;
+        default: return 1;
+    }
+}
+
+/**
+ * The first step boundary after t, when pin levels may change.
+ */
+static uint64_t next_boundary(uint64_t t)
+{
+    uint64_t end = 0;
+    for (int i = 0; i < sim.num_steps; i++) {
+        end += sim.steps[i].ms * 1000ull;
+        if (end > t) return end;
+    }
+    return ~(uint64_t) 0;
+}
+
+/**
+ * Run the interrupt handlers due by now, in time order.
+ */
+static void deliver_interrupts(uint64_t now)
+{
+    sim.in_irq = 1;
+    for (;;) {
+        uint64_t t = num_edges ? next_boundary(sim.serviced_us) : ~(uint64_t) 0;
+        int timer = -1;
+        for (int i = 0; i < SIM_MAX_TIMERS; i++) {
+            if (timers[i].armed && timers[i].due < t) {
+                t = timers[i].due;
+                timer = i;
+            }
+        }
+        if (t > now) break;
+
+        sim.irq_us = t;
+        if (t > sim.serviced_us) sim.serviced_us = t;
+        if (timer >= 0) {
+            if (timers[timer].period) timers[timer].due += timers[timer].period;
+            else timers[timer].armed = 0;
+            timers[timer].fn();
+        } else {
+            for (int i = 0; i < num_edges; i++) {
+                int level = level_at(edges[i].pin, t);
+                if (level == edges[i].level) continue;
+                edges[i].level = level;
+                void (*fn)() = level ? edges[i].rise : edges[i].fall;
+                if (fn) fn();
+            }
+        }
+    }
+    sim.serviced_us = now;
+    sim.in_irq = 0;
+}
+
+uint64_t sim_time_us()
+{
+    sim_init();
+    if (sim.in_irq) return sim.irq_us;
+    uint64_t now = (host_ns() - sim.host_start_ns) / 1000 + sim.virtual_us;
+    deliver_interrupts(now);
+    return now;
+}
+
+void sim_advance_us(uint64_t us)
+{
+    sim_init();
+    sim.virtual_us += us;
+}
+
+int sim_pin_read(int pin)
+{
+    current_step(); // Ends the run if the script is over
+    return level_at(pin, sim_time_us());
+}
+
+void sim_pin_write(int pin, int value)
+{
+}
+
+void sim_edge_attach(int pin, void (*rise)(), void (*fall)())
+{
+    uint64_t now = sim_time_us();
+    int i = 0;
+    while (i < num_edges && edges[i].pin != pin) i++;
+    if (i == num_edges) {
+        if (num_edges == SIM_MAX_EDGES) {
+            fprintf(stderr, "sim: too many interrupt pins\n");
+            exit(1);
+        }
+        num_edges++;
+        edges[i].pin = pin;
+        edges[i].level = level_at(pin, now);
+    }
+    edges[i].rise = rise;
+    edges[i].fall = fall;
+}
+
+int sim_timer_attach(int slot, void (*fn)(), unsigned us, int repeat)
+{
+    uint64_t now = sim_time_us();
+    if (slot < 0) {
+        slot = 0;
+        while (slot < SIM_MAX_TIMERS && timers[slot].used) slot++;
+        if (slot == SIM_MAX_TIMERS) {
+            fprintf(stderr, "sim: too many tickers\n");
+            exit(1);
+        }
+    }
+    timers[slot].fn = fn;
+    timers[slot].due = now + (us ? us : 1);
+    timers[slot].period = repeat ? (us ? us : 1) : 0;
+    timers[slot].used = 1;
+    timers[slot].armed = 1;
+    return slot;
+}
+
+void sim_timer_detach(int slot)
+{
+    if (slot < 0) return;
+    timers[slot].used = 0;
+    timers[slot].armed = 0;
+}
+
+void sim_accel(double* x, double* y, double* z)
+{
+    SimStep* step = current_step();
+    *x = step ? step->ax : 0.0;
+    *y = step ? step->ay : 0.0;
+    *z = step ? step->az : 1.0;
+}
+
+void sim_lcd_command(unsigned bytes)
+{
+    sim_init();
+    // 10 bits per byte on the wire, plus the display's one-byte ACK
+    uint64_t us = (bytes + 1) * 10ull * 1000000 / sim.lcd_baud;
+    sim.stats.lcd_commands++;
+    sim.stats.lcd_bytes += bytes;
+    sim.stats.lcd_us += us;
+    sim.virtual_us += us;
+}
+
+void sim_lcd_baud(int rate)
+{
+    sim_init();
+    sim.lcd_baud = rate;
+}
+
+unsigned short* sim_lcd_pixels()
+{
+    return sim.lcd;
+}
+
+int sim_lcd_save_ppm(const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if (!file) return -1;
+    fprintf(file, "P6\n%d %d\n255\n", SIM_LCD_SIZE, SIM_LCD_SIZE);
+    for (int i = 0; i < SIM_LCD_SIZE * SIM_LCD_SIZE; i++) {
+        unsigned c = sim.lcd[i];
+        unsigned char rgb[3] = {
+            (unsigned char) ((c >> 11) << 3),
+            (unsigned char) (((c >> 5) & 0x3F) << 2),
+            (unsigned char) ((c & 0x1F) << 3)
+        };
+        fwrite(rgb, 1, 3, file);
+    }
+    return fclose(file);
+}
+
+SimStats* sim_stats()
+{
+    return &sim.stats;
+}
+
+void sim_finish()
+{
+    uint64_t total = sim_time_us();
+    uint64_t cpu = (host_ns() - sim.host_start_ns) / 1000;
+    printf("\nsim: %.3f s simulated (%.3f s host CPU, %.3f s waiting, %.3f s LCD link, %.3f s I2C)\n",
+           total / 1e6, cpu / 1e6, sim.stats.wait_us / 1e6, sim.stats.lcd_us / 1e6,
+           sim.stats.i2c_us / 1e6);
+    printf("sim: LCD %lu commands, %lu bytes, %lu BLITs (%lu pixels)\n",
+           sim.stats.lcd_commands, sim.stats.lcd_bytes, sim.stats.lcd_blits,
+           sim.stats.lcd_blit_pixels);
+    const char* ppm = getenv("SIM_PPM");
+    if (ppm && sim_lcd_save_ppm(ppm)) fprintf(stderr, "sim: cannot write %s\n", ppm);
+    fflush(stdout);
+    _exit(0);
+}
+
+// mbed ------------------------------------------------------------------------
+
+void wait_us(int us)
+{
+    sim_init();
+    if (us <= 0) return;
+    sim.stats.wait_us += us;
+    sim.virtual_us += us;
+    current_step(); // Ends the run if the script is over
+}
+
+void wait_ms(int ms)
+{
+    wait_us(ms * 1000);
+}
+
+void wait(float s)
+{
+    wait_us((int) (s * 1000000));
+}
+
+int Serial::putc(int c)
+{
+    return fputc(c, stdout);
+}
+
+int Serial::printf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n;
+}
+
+// uLCD_4DGL -------------------------------------------------------------------
+
+#define FONT_W 7
+#define FONT_H 8
+
+static unsigned short to_565(int color)
+{
+    return ((color >> 19) & 0x1F) << 11 | ((color >> 10) & 0x3F) << 5 | ((color >> 3) & 0x1F);
+}
+
+static void lcd_put(int x, int y, int color)
+{
+    if (x < 0 || y < 0 || x >= SIM_LCD_SIZE || y >= SIM_LCD_SIZE) return;
+    sim.lcd[y * SIM_LCD_SIZE + x] = to_565(color);
+}
+
+uLCD_4DGL::uLCD_4DGL(PinName tx, PinName rx, PinName rst)
+    : _background(BLACK), _text_color(GREEN), _text_background(BLACK),
+      _col(0), _row(0), _text_w(1), _text_h(1)
+{
+}
+
+void uLCD_4DGL::fill(int x1, int y1, int x2, int y2, int color)
+{
+    if (x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { int t = y1; y1 = y2; y2 = t; }
+    for (int y = y1; y <= y2; y++)
+        for (int x = x1; x <= x2; x++)
+            lcd_put(x, y, color);
+}
+
+void uLCD_4DGL::cls()
+{
+    sim_lcd_command(2);
+    fill(0, 0, SIM_LCD_SIZE - 1, SIM_LCD_SIZE - 1, _background);
+    _col = _row = 0;
+}
+
+void uLCD_4DGL::background_color(int color)
+{
+    sim_lcd_command(4);
+    _background = color;
+}
+
+void uLCD_4DGL::BLIT(int x, int y, int w, int h, int* colors)
+{
+    sim_lcd_command(10 + 2 * w * h);
+    sim.stats.lcd_blits++;
+    sim.stats.lcd_blit_pixels += w * h;
+    for (int j = 0; j < h; j++)
+        for (int i = 0; i < w; i++)
+            lcd_put(x + i, y + j, colors[j * w + i]);
+}
+
+void uLCD_4DGL::pixel(int x, int y, int color)
+{
+    sim_lcd_command(8);
+    lcd_put(x, y, color);
+}
+
+void uLCD_4DGL::line(int x1, int y1, int x2, int y2, int color)
+{
+    sim_lcd_command(12);
+    int dx = abs(x2 - x1), dy = abs(y2 - y1);
+    int sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
+    int err = dx - dy;
+    while (1) {
+        lcd_put(x1, y1, color);
+        if (x1 == x2 && y1 == y2) break;
+        int e2 = 2 * err;
+        if (e2 > -dy) { err -= dy; x1 += sx; }
+        if (e2 < dx) { err += dx; y1 += sy; }
+    }
+}
+
+void uLCD_4DGL::rectangle(int x1, int y1, int x2, int y2, int color)
+{
+    sim_lcd_command(12);
+    for (int x = x1; x <= x2; x++) { lcd_put(x, y1, color); lcd_put(x, y2, color); }
+    for (int y = y1; y <= y2; y++) { lcd_put(x1, y, color); lcd_put(x2, y, color); }
+}
+
+void uLCD_4DGL::filled_rectangle(int x1, int y1, int x2, int y2, int color)
+{
+    sim_lcd_command(12);
+    fill(x1, y1, x2, y2, color);
+}
+
+void uLCD_4DGL::circle(int x, int y, int radius, int color)
+{
+    sim_lcd_command(10);
+    for (int j = -radius; j <= radius; j++)
+        for (int i = -radius; i <= radius; i++) {
+            int d = i * i + j * j;
+            if (d <= radius * radius && d > (radius - 1) * (radius - 1))
+                lcd_put(x + i, y + j, color);
+        }
+}
+
+void uLCD_4DGL::filled_circle(int x, int y, int radius, int color)
+{
+    sim_lcd_command(10);
+    for (int j = -radius; j <= radius; j++)
+        for (int i = -radius; i <= radius; i++)
+            if (i * i + j * j <= radius * radius) lcd_put(x + i, y + j, color);
+}
+
+void uLCD_4DGL::locate(char col, char row)
+{
+    sim_lcd_command(6);
+    _col = col;
+    _row = row;
+}
+
+void uLCD_4DGL::color(int color)
+{
+    sim_lcd_command(4);
+    _text_color = color;
+}
+
+void uLCD_4DGL::textbackground_color(int color)
+{
+    sim_lcd_command(4);
+    _text_background = color;
+}
+
+void uLCD_4DGL::text_width(char width)
+{
+    sim_lcd_command(4);
+    _text_w = width;
+}
+
+void uLCD_4DGL::text_height(char height)
+{
+    sim_lcd_command(4);
+    _text_h = height;
+}
+
+int uLCD_4DGL::putc(int c)
+{
+    if (sim.verbose) fputc(c, stderr);
+    if (c == '\n') {
+        _col = 0;
+        _row += _text_h;
+        return c;
+    }
+    sim_lcd_command(4);
+    int x = _col * FONT_W, y = _row * FONT_H;
+    fill(x, y, x + FONT_W * _text_w - 1, y + FONT_H * _text_h - 1, _text_background);
+    _col += _text_w;
+    if ((_col + _text_w) * FONT_W > SIM_LCD_SIZE) {
+        _col = 0;
+        _row += _text_h;
+    }
+    return c;
+}
+
+int uLCD_4DGL::printf(const char* format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    for (char* c = text; *c; c++) putc(*c);
+    return n;
+}
+
+void uLCD_4DGL::baudrate(int speed)
+{
+    sim_lcd_command(4);
+    sim_lcd_baud(speed);
+}
+
+// MMA8452 ---------------------------------------------------------------------
+
+/**
+ * Bus time of reading bytes consecutive registers: start, address and
+ * register, repeated start and address, the data, stop; 9 bits per byte.
+ */
+static void i2c_read(int frequency, int bytes)
+{
+    uint64_t us = ((3 + bytes) * 9 + 2) * 1000000ull / frequency;
+    sim.stats.i2c_us += us;
+    sim.virtual_us += us;
+}
+
+int MMA8452::readXGravity(double* x)
+{
+    double y, z;
+    i2c_read(_frequency, 2);
+    sim_accel(x, &y, &z);
+    return 0;
+}
+
+int MMA8452::readYGravity(double* y)
+{
+    double x, z;
+    i2c_read(_frequency, 2);
+    sim_accel(&x, y, &z);
+    return 0;
+}
+
+int MMA8452::readZGravity(double* z)
+{
+    double x, y;
+    i2c_read(_frequency, 2);
+    sim_accel(&x, &y, z);
+    return 0;
+}
+
+int MMA8452::readXYZGravity(double* x, double* y, double* z)
+{
+    i2c_read(_frequency, 6);
+    sim_accel(x, y, z);
+    return 0;
+}
+
+// wave_player -----------------------------------------------------------------
+
+static unsigned read_le32(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned) p[3] << 24);
+}
+
+void wave_player::play(FILE* wavefile)
+{
+    unsigned char riff[12], chunk[8], fmt[16];
+    unsigned byte_rate = 0;
+    if (!wavefile || fread(riff, 1, 12, wavefile) != 12) return;
+    while (fread(chunk, 1, 8, wavefile) == 8) {
+        unsigned size = read_le32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4) && size >= 16) {
+            if (fread(fmt, 1, 16, wavefile) != 16) return;
+            byte_rate = read_le32(fmt + 8);
+            fseek(wavefile, size - 16, SEEK_CUR);
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (byte_rate) wait_us((int) (size * 1000000ull / byte_rate));
+            return;
+        } else {
+            fseek(wavefile, size, SEEK_CUR);
+        }
+    }
+}
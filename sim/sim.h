@@ -0,0 +1,108 @@
+#ifndef SIM_H
+#define SIM_H
+
+/*
+ * Control and inspection interface of the host simulator. The stand-in
+ * hardware classes call into this; tools and benchmarks built on the
+ * simulator can use it directly.
+ *
+ * The run is configured through the environment:
+ *
+ *      SIM_SCRIPT   input script (see below); without one every button is
+ *                   released and the board lies flat, forever
+ *      SIM_PPM      write the final LCD contents to this file (binary PPM)
+ *      SIM_TIMEOUT  stop after this many real seconds (default 60), which
+ *                   also ends runs stuck in the game over screen
+ *      SIM_VERBOSE  if set, echo text written to the LCD on stderr
+ *
+ * A script holds one step per line, each lasting the given milliseconds of
+ * simulated time:
+ *
+ *      # ms   b1 b2 b3   ax    ay    az
+ *      500    1  0  1    0.0   0.0   1.0
+ *
+ * Buttons read 0 while pressed (the pins are pulled up). When the last step
+ * ends, the simulator prints its statistics and exits.
+ */
+
+#include <stdint.h>
+
+/**
+ * Simulated time in microseconds since start: CPU time actually spent on the
+ * host plus every wait and the modeled LCD transfer time.
+ */
+uint64_t sim_time_us();
+
+/**
+ * Advance simulated time without using the CPU.
+ */
+void sim_advance_us(uint64_t us);
+
+/**
+ * Input pins. sim_pin_read returns the scripted level for the buttons (p21,
+ * p22, p23) and 1 for other pins.
+ */
+int sim_pin_read(int pin);
+void sim_pin_write(int pin, int value);
+
+/**
+ * Interrupts. Edge handlers run when a scripted pin level changes, timer
+ * handlers when their time comes; both are delivered in time order the next
+ * time anything reads the clock or waits, with sim_time_us reporting the
+ * time each was due while it runs. Handlers do not nest. A loop that only
+ * polls state kept by interrupts must wait, or it never sees them change.
+ *
+ * sim_edge_attach sets the rise and fall handlers of pin (either may be
+ * NULL). sim_timer_attach schedules fn us microseconds from now, every us if
+ * repeat is nonzero, in slot (-1 to take a free one) and returns the slot;
+ * sim_timer_detach frees it.
+ */
+#define SIM_MAX_EDGES 8
+#define SIM_MAX_TIMERS 16
+void sim_edge_attach(int pin, void (*rise)(), void (*fall)());
+int sim_timer_attach(int slot, void (*fn)(), unsigned us, int repeat);
+void sim_timer_detach(int slot);
+
+/**
+ * Current scripted accelerometer reading, in g.
+ */
+void sim_accel(double* x, double* y, double* z);
+
+/**
+ * LCD traffic: account for a command of the given size on the serial link.
+ */
+void sim_lcd_command(unsigned bytes);
+void sim_lcd_baud(int rate);
+
+/**
+ * The LCD contents as RGB565, row-major, SIM_LCD_SIZE pixels square.
+ */
+#define SIM_LCD_SIZE 128
+unsigned short* sim_lcd_pixels();
+
+/**
+ * Write the LCD contents as a binary PPM. Returns 0 on success.
+ */
+int sim_lcd_save_ppm(const char* path);
+
+/**
+ * Counters collected during the run.
+ */
+typedef struct {
+    unsigned long lcd_commands;   // Commands sent to the LCD
+    unsigned long lcd_bytes;      // Bytes sent to the LCD
+    unsigned long lcd_blits;      // BLIT commands
+    unsigned long lcd_blit_pixels;
+    uint64_t lcd_us;              // Modeled time spent on the serial link
+    uint64_t i2c_us;              // Modeled time spent on the I2C bus
+    uint64_t wait_us;             // Time spent in wait/wait_ms/wait_us
+} SimStats;
+
+SimStats* sim_stats();
+
+/**
+ * Print the statistics, write SIM_PPM if requested and exit.
+ */
+void sim_finish();
+
+#endif // SIM_H
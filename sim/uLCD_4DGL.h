@@ -0,0 +1,51 @@
+#ifndef SIM_ULCD_4DGL_H
+#define SIM_ULCD_4DGL_H
+
+/*
+ * Host stand-in for the 4DGL-uLCD-SE library. Drawing commands update an
+ * in-memory 128x128 RGB565 screen (sim_lcd_pixels) and charge the serial link
+ * for the bytes the real library would send. Text only paints the character
+ * cell background; glyphs are not rendered.
+ */
+
+#include "mbed.h"
+
+#define WHITE 0xFFFFFF
+#define BLACK 0x000000
+#define RED   0xFF0000
+#define GREEN 0x00FF00
+#define BLUE  0x0000FF
+#define LGREY 0xBFBFBF
+#define DGREY 0x5F5F5F
+
+class uLCD_4DGL {
+public:
+    uLCD_4DGL(PinName tx, PinName rx, PinName rst);
+
+    void cls();
+    void background_color(int color);
+    void BLIT(int x, int y, int w, int h, int* colors);
+    void pixel(int x, int y, int color);
+    void line(int x1, int y1, int x2, int y2, int color);
+    void rectangle(int x1, int y1, int x2, int y2, int color);
+    void filled_rectangle(int x1, int y1, int x2, int y2, int color);
+    void circle(int x, int y, int radius, int color);
+    void filled_circle(int x, int y, int radius, int color);
+
+    void locate(char col, char row);
+    void color(int color);
+    void textbackground_color(int color);
+    void text_width(char width);
+    void text_height(char height);
+    int putc(int c);
+    int printf(const char* format, ...);
+
+    void baudrate(int speed);
+
+private:
+    void fill(int x1, int y1, int x2, int y2, int color);
+    int _background, _text_color, _text_background;
+    int _col, _row, _text_w, _text_h;
+};
+
+#endif // SIM_ULCD_4DGL_H
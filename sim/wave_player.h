@@ -0,0 +1,18 @@
+#ifndef SIM_WAVE_PLAYER_H
+#define SIM_WAVE_PLAYER_H
+
+/*
+ * Host stand-in for wave_player. play() reads the WAV header and advances
+ * simulated time by the clip's length instead of driving the DAC.
+ */
+
+#include "mbed.h"
+
+class wave_player {
+public:
+    wave_player(AnalogOut* dac) {}
+    void set_verbosity(int v) {}
+    void play(FILE* wavefile);
+};
+
+#endif // SIM_WAVE_PLAYER_H
@@ -0,0 +1,254 @@
+/*
+ * world_test: streaming a chunked world from the card (world.cpp) and playing
+ * on it through the map (map_stream_world), on the host. Run with
+ *
+ *      make -C sim test
+ *
+ * The world is WORLD_TEST_W x WORLD_TEST_H tiles, so it spans more chunks
+ * than the cache holds and every pass over it evicts. The world file is
+ * made by world_create and world_edit in the simulator's SD card directory.
+ * Prints each failed check and exits nonzero if there was one.
+ */
+#include "globals.h"
+#include "map.h"
+#include "world.h"
+
+#include <stdio.h>
+
+#define TEST_WORLD "world_test"
+#define WORLD_TEST_W 100    // 7 chunks across, the last one partly used
+#define WORLD_TEST_H 70     // 5 chunks down
+#define TEST_MAP 0
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/**
+ * The tile the test writes at (x,y): never TILE_NONE, different in
+ * neighboring cells.
+ */
+static int pattern(int x, int y)
+{
+    return 1 + (x * 7 + y * 13) % (NUM_TILE_KINDS - 1);
+}
+
+/**
+ * The tile at (x,y) as stored in the file right now, bypassing the cache, or
+ * -1 if it cannot be read.
+ */
+static int tile_on_card(int x, int y)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/worlds/%s.wld", WORLD_ROOT, TEST_WORLD);
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    int chunks_w = (WORLD_TEST_W + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    long chunk = (y / CHUNK_SIZE) * chunks_w + x / CHUNK_SIZE;
+    // After the 16-byte header (see world.h)
+    fseek(file, 16 + chunk * CHUNK_SIZE * CHUNK_SIZE + (y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE, SEEK_SET);
+    int tile = fgetc(file);
+    fclose(file);
+    return tile == EOF ? -1 : tile;
+}
+
+/**
+ * The tile at offset in the chunk at slot of the scratch file of the world
+ * opened for play, or -1 if there is no such chunk.
+ */
+static int scratch_tile(int slot, int offset)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "%s/worlds/%s.tmp", WORLD_ROOT, TEST_WORLD);
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    fseek(file, (long) slot * CHUNK_SIZE * CHUNK_SIZE + offset, SEEK_SET);
+    int tile = fgetc(file);
+    fclose(file);
+    return tile == EOF ? -1 : tile;
+}
+
+/**
+ * A new world is empty, and everything written through world_edit comes back
+ * after the world is closed and opened again, through many evictions.
+ */
+static void test_create_and_fill()
+{
+    CHECK(world_create(TEST_WORLD, WORLD_TEST_W, WORLD_TEST_H));
+    World* world = world_edit(TEST_WORLD);
+    CHECK(world != NULL);
+    if (!world) return;
+    CHECK(world_width(world) == WORLD_TEST_W);
+    CHECK(world_height(world) == WORLD_TEST_H);
+    CHECK(world_get(world, 0, 0) == 0);
+    CHECK(world_get(world, WORLD_TEST_W - 1, WORLD_TEST_H - 1) == 0);
+    CHECK(world_get(world, -1, 0) == -1);
+    CHECK(world_get(world, WORLD_TEST_W, 0) == -1);
+    CHECK(world_get(world, 0, WORLD_TEST_H) == -1);
+
+    for (int y = 0; y < WORLD_TEST_H; y++)
+        for (int x = 0; x < WORLD_TEST_W; x++) world_set(world, x, y, pattern(x, y));
+    world_set(world, WORLD_TEST_W, 0, 1);   // Outside: ignored
+    world_close(world);
+
+    world = world_open(TEST_WORLD);
+    CHECK(world != NULL);
+    if (!world) return;
+    int wrong = 0;
+    for (int y = 0; y < WORLD_TEST_H; y++)
+        for (int x = 0; x < WORLD_TEST_W; x++) wrong += world_get(world, x, y) != pattern(x, y);
+    CHECK(wrong == 0);
+    world_close(world);
+}
+
+/**
+ * A full cache evicts the least recently used chunk, saving it to the scratch
+ * file if it was modified, and keeps the ones used since. The world file
+ * itself never changes, and closing drops the changes.
+ */
+static void test_lru_eviction()
+{
+    World* world = world_open(TEST_WORLD);
+    CHECK(world != NULL);
+    if (!world) return;
+
+    // Two modified chunks, (0,0) and then (1,0), changed at different places
+    world_set(world, 0, 0, 0);
+    world_set(world, CHUNK_SIZE + 1, 0, 0);
+
+    // Fill the rest of the cache with chunks of the next rows
+    int loaded = 2;
+    for (int cy = 1; loaded < WORLD_CACHE_CHUNKS; cy++)
+        for (int cx = 0; cx < 6 && loaded < WORLD_CACHE_CHUNKS; cx++, loaded++)
+            world_get(world, cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+
+    // Use (0,0) again, so (1,0) is now the least recently used
+    world_get(world, 0, 0);
+    CHECK(scratch_tile(0, 0) == -1);
+
+    // One more chunk evicts (1,0), which is saved first; (0,0) stays cached
+    // until the flush saves it after
+    world_get(world, 6 * CHUNK_SIZE, 4 * CHUNK_SIZE);
+    world_flush(world);
+    CHECK(scratch_tile(0, 1) == 0);
+    CHECK(scratch_tile(0, 0) == pattern(CHUNK_SIZE, 0));
+    CHECK(scratch_tile(1, 0) == 0);
+    CHECK(scratch_tile(2, 0) == -1);
+    CHECK(tile_on_card(CHUNK_SIZE + 1, 0) == pattern(CHUNK_SIZE + 1, 0));
+
+    // Reading (1,0) back pages it in from the scratch file with the change;
+    // changed and evicted again, it keeps its place there
+    CHECK(world_get(world, CHUNK_SIZE + 1, 0) == 0);
+    world_set(world, CHUNK_SIZE + 2, 0, 0);
+    for (int cy = 1; cy < 5; cy++)
+        for (int cx = 0; cx < 7; cx++) world_get(world, cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+    world_flush(world);
+    CHECK(scratch_tile(0, 2) == 0);
+    CHECK(scratch_tile(2, 0) == -1);
+    CHECK(world_get(world, 0, 0) == 0);
+    CHECK(world_get(world, CHUNK_SIZE + 1, 0) == 0);
+    CHECK(world_get(world, CHUNK_SIZE + 2, 0) == 0);
+    CHECK(tile_on_card(0, 0) == pattern(0, 0));
+
+    // Closing drops the changes and the scratch file
+    world_close(world);
+    CHECK(tile_on_card(0, 0) == pattern(0, 0));
+    CHECK(tile_on_card(CHUNK_SIZE + 1, 0) == pattern(CHUNK_SIZE + 1, 0));
+    CHECK(scratch_tile(0, 0) == -1);
+    world = world_open(TEST_WORLD);
+    CHECK(world != NULL);
+    if (!world) return;
+    CHECK(world_get(world, 0, 0) == pattern(0, 0));
+    world_close(world);
+}
+
+/**
+ * The world as a map: get_here reads through the chunk cache on both sides
+ * of chunk boundaries, changes go to the world, and loading another layout
+ * afterwards leaves nothing of the world behind.
+ */
+static void test_streamed_map()
+{
+    CHECK(map_stream_world(TEST_MAP, TEST_WORLD) != NULL);
+    set_active_map(TEST_MAP);
+    CHECK(map_width() == WORLD_TEST_W);
+    CHECK(map_height() == WORLD_TEST_H);
+
+    for (int y = CHUNK_SIZE - 2; y < CHUNK_SIZE + 2; y++) {
+        for (int x = 2 * CHUNK_SIZE - 2; x < 2 * CHUNK_SIZE + 2; x++) {
+            CHECK(get_here(x, y) == get_prototype(pattern(x, y)));
+        }
+    }
+    CHECK(get_east(CHUNK_SIZE - 1, 5) == get_prototype(pattern(CHUNK_SIZE, 5)));
+    CHECK(get_south(5, CHUNK_SIZE - 1) == get_prototype(pattern(5, CHUNK_SIZE)));
+    CHECK(get_here(WORLD_TEST_W - 1, WORLD_TEST_H - 1) == get_prototype(pattern(WORLD_TEST_W - 1, WORLD_TEST_H - 1)));
+    CHECK(get_here(WORLD_TEST_W, 0) == NULL);
+    CHECK(get_here(-1, 0) == NULL);
+
+    // Walk the viewport across the whole world, paging as the game does
+    int wrong = 0;
+    for (int y = 0; y < WORLD_TEST_H; y += 3) {
+        for (int x = 0; x < WORLD_TEST_W; x += 3) {
+            map_prefetch(x, y);
+            wrong += get_here(x, y) != get_prototype(pattern(x, y));
+        }
+    }
+    CHECK(wrong == 0);
+
+    // Stateless tiles are stored in the world, instances beside it
+    add_tile(40, 40, TILE_GRAVE);
+    CHECK(get_here(40, 40) == get_prototype(TILE_GRAVE));
+    map_erase(40, 40);
+    CHECK(get_here(40, 40) == NULL);
+    add_stairs(41, 40, 1, 2, 3);
+    MapItem* stairs = get_here(41, 40);
+    CHECK(stairs != NULL && tile_kind(stairs) == TILE_NONE && stairs->type == LADDAR);
+    if (stairs && stairs->data) CHECK(((StairsData*) stairs->data)->tm == 1);
+
+    // Streaming another world replaces this one, and streaming this one
+    // again starts it over
+    CHECK(world_create(TEST_WORLD "2", 10, 5));
+    CHECK(map_stream_world(TEST_MAP, TEST_WORLD "2") != NULL);
+    CHECK(map_width() == 10);
+    CHECK(map_height() == 5);
+    CHECK(get_here(0, 0) == NULL);
+    CHECK(map_stream_world(TEST_MAP, TEST_WORLD) != NULL);
+    CHECK(map_width() == WORLD_TEST_W);
+    CHECK(get_here(40, 40) == get_prototype(pattern(40, 40)));
+    CHECK(get_here(41, 40) == get_prototype(pattern(41, 40)));
+    CHECK(map_stream_world(TEST_MAP, "no_such_world") == NULL);
+    CHECK(map_width() == WORLD_TEST_W);
+
+    // Replacing the world with a small layout drops all of it
+    map_build(TEST_MAP, "W L" "  W", 3, 2, NULL);
+    CHECK(map_width() == 3);
+    CHECK(map_height() == 2);
+    CHECK(get_here(0, 0) == get_prototype(TILE_WALL));
+    CHECK(get_here(2, 1) == get_prototype(TILE_WALL));
+    CHECK(get_here(41, 40) == NULL);
+    CHECK(get_here(2 * CHUNK_SIZE, CHUNK_SIZE) == NULL);
+
+    // and the world file is as it was
+    CHECK(tile_on_card(40, 40) == pattern(40, 40));
+    CHECK(tile_on_card(41, 40) == pattern(41, 40));
+}
+
+int main()
+{
+    maps_init();
+    test_create_and_fill();
+    test_lru_eviction();
+    test_streamed_map();
+
+    if (failures) {
+        printf("world_test: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("world_test: ok\n");
+    return 0;
+}
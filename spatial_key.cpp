@@ -0,0 +1,44 @@
+#include "spatial_key.h"
+
+unsigned int cantor_key(int x, int y)
+{
+    return (x + y) * (x + y + 1) / 2 + x;
+}
+
+unsigned int packed_key(int x, int y)
+{
+    return ((unsigned int) x & 0xFFFF) << 16 | ((unsigned int) y & 0xFFFF);
+}
+
+/**
+ * Spread the low 16 bits of v to the even bit positions.
+ */
+static unsigned int spread_bits(unsigned int v)
+{
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+unsigned int morton_key(int x, int y)
+{
+    return spread_bits(x) | (spread_bits(y) << 1);
+}
+
+unsigned int identity_hash(unsigned int key)
+{
+    return key;
+}
+
+unsigned int mix_hash(unsigned int key)
+{
+    key ^= key >> 16;
+    key *= 0x85ebca6bu;
+    key ^= key >> 13;
+    key *= 0xc2b2ae35u;
+    key ^= key >> 16;
+    return key;
+}
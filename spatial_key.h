@@ -0,0 +1,50 @@
+#ifndef SPATIAL_KEY_H
+#define SPATIAL_KEY_H
+
+#include "hash_table.h"
+
+/**
+ * Ways to turn map coordinates into hash table keys, and hash functions to go
+ * with them. The map picks one of each with map_set_hashing.
+ */
+
+/**
+ * A function that turns (x,y) into a single unsigned key. Every key function
+ * here must give distinct keys for distinct cells in its documented range.
+ */
+typedef unsigned int (*CoordKeyFunc)(int x, int y);
+
+/**
+ * Cantor pairing: (x+y)(x+y+1)/2 + x. This was the map's original XY_KEY. It
+ * is only one-to-one for x, y >= 0, and neighboring cells get nearby keys
+ * along diagonals, so it needs a mixing hash to spread well.
+ */
+unsigned int cantor_key(int x, int y);
+
+/**
+ * x in the high 16 bits, y in the low 16 bits (two's complement). One-to-one
+ * for -32768 <= x, y <= 32767.
+ */
+unsigned int packed_key(int x, int y);
+
+/**
+ * Morton (Z-order) key: the low 16 bits of x and y interleaved, x in the even
+ * bits. Cells close on the map get close keys, which keeps neighbors together
+ * when the key is used for ordering. One-to-one over the same range as
+ * packed_key.
+ */
+unsigned int morton_key(int x, int y);
+
+/**
+ * Returns the key unchanged. Only a good hash for keys that are already
+ * spread out.
+ */
+unsigned int identity_hash(unsigned int key);
+
+/**
+ * A strong integer mixer (the MurmurHash3 finalizer): every input bit affects
+ * every output bit, so structured keys spread evenly over any bucket count.
+ */
+unsigned int mix_hash(unsigned int key);
+
+#endif // SPATIAL_KEY_H
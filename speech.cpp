@@ -5,106 +5,217 @@
 
 #define PURPLE 0x800080
 
+/**
+ * Screen rows the bubble covers.
+ */
+#define BUBBLE_TOP 93
+#define BUBBLE_BOTTOM 113
+
+/**
+ * Ticks the "press to continue" light stays on, then off, under a full page.
+ */
+#define BLINK_TICKS 4
+
+/**
+ * The dialogue: its word-wrapped lines, each a span of the caller's text,
+ * and how far it has been typed. Lines come in whole pages; the last page of
+ * each speech is padded with empty lines.
+ */
+static struct {
+    const char* text[SPEECH_MAX_LINES];
+    unsigned char len[SPEECH_MAX_LINES];
+    int lines;      // Lines queued
+    int page;       // First line of the page shown
+    int typed;      // Characters of the page shown so far
+    int blink;      // Ticks since the page was complete
+    int open;       // Whether the bubble is up
+    int held;       // Whether the action button was down last tick
+    int swallow;    // Keep the action button from the game until released
+} dlg;
+
 /**
  * Draw the speech bubble background.
  */
 static void draw_speech_bubble();
 
 /**
- * Erase the speech bubble.
+ * Erase the speech bubble. Nothing is drawn: the map redraws the tiles it
+ * covered (see speech_covers).
  */
 static void erase_speech_bubble();
 
 /**
- * Draw a single line of the speech bubble.
- * @param line The text to display
+ * Draw characters from to to - 1 of a single line of the speech bubble.
+ * @param line The text of the line
  * @param which If TOP, the first line; if BOTTOM, the second line.
  */
 #define TOP 0
 #define BOTTOM 1
-static void draw_speech_line(const char *line, int which);
+static void draw_speech_line(const char *line, int from, int to, int which);
 
 /**
- * Delay until it is time to scroll.
+ * Show or hide the light telling that the page is complete.
  */
-static void speech_bubble_wait();
+static void draw_speech_prompt(int on);
 
 void draw_speech_bubble()
 {
-    uLCD.filled_rectangle(3, 93, 123, 113, GREEN);
-    uLCD.filled_rectangle(4, 94, 122, 112, PURPLE);
+    uLCD.filled_rectangle(3, BUBBLE_TOP, 123, BUBBLE_BOTTOM, GREEN);
+    uLCD.filled_rectangle(4, BUBBLE_TOP + 1, 122, BUBBLE_BOTTOM - 1, PURPLE);
 }
 
 void erase_speech_bubble()
 {
+    dlg.open = 0;
+    dlg.lines = 0;
 }
 
-void draw_speech_line(const char *line, int which)
+void draw_speech_line(const char *line, int from, int to, int which)
 {
+    uLCD.textbackground_color(PURPLE);
+    uLCD.locate(1 + from, 12 + which);
+    for (int i = from; i < to; i++) {
+        uLCD.printf("%c", line[i]);
+    }
 }
 
-int readPB1(int pb1)
+void draw_speech_prompt(int on)
 {
-    GameInputs inputs;
-    inputs = read_inputs();
-    if (inputs.b1 == 0)
-        pb1 = 0;
-    return pb1;
+    uLCD.filled_circle(117, 108, 3, on ? RED : PURPLE);
 }
 
-void speech_bubble_wait()
+static void add_line(const char* text, int len)
 {
-    int pb1 = 1;
-    while (pb1 == 1) {
-        for (int i = 0; i < 4; i++) {
-            uLCD.filled_circle(120, 15, 4, RED);
-            wait(0.1);
-            pb1 = readPB1(pb1);
+    if (dlg.lines == SPEECH_MAX_LINES) return;
+    dlg.text[dlg.lines] = text;
+    dlg.len[dlg.lines] = len;
+    dlg.lines++;
+}
+
+/**
+ * Break text into lines of at most SPEECH_LINE_LEN characters at spaces and
+ * newlines, and queue them. A word longer than a line is split.
+ */
+static void wrap(const char* text)
+{
+    while (dlg.lines < SPEECH_MAX_LINES) {
+        while (*text == ' ') text++;    // Lines never start with a space
+        if (!*text) break;
+
+        // The most whole words that fit
+        int len = 0, fit = 0;
+        while (len < SPEECH_LINE_LEN && text[len] && text[len] != '\n') {
+            len++;
+            if (!text[len] || text[len] == ' ' || text[len] == '\n') fit = len;
         }
+        if (!fit) fit = len;
 
-        if (pb1 == 0)
-            break;
+        add_line(text, fit);
+        text += fit;
+        if (*text == '\n') text++;
+    }
+}
 
-        for (int i = 0; i < 4; i++) {
-            uLCD.filled_circle(120, 15, 4, BLACK);
-            wait(0.1);
-            pb1 = readPB1(pb1);
-        }
+/**
+ * Queue text, starting the bubble if it is not up, and pad to a whole page.
+ */
+static void begin(const char* lines[], int n)
+{
+    if (!dlg.open) {
+        dlg.lines = 0;
+        dlg.page = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        wrap(lines[i]);
+    }
+    while (dlg.lines % SPEECH_PAGE_LINES) {
+        add_line("", 0);
+    }
+
+    if (!dlg.open && dlg.lines) {
+        dlg.open = 1;
+        dlg.typed = 0;
+        dlg.blink = 0;
+        draw_speech_bubble();
     }
 }
 
 void speech(const char *line)
 {
-    uLCD.textbackground_color(PURPLE);
-    int i;
-    while (*line) {
-        draw_speech_bubble();
+    begin(&line, 1);
+}
 
-        i = 0;
-        uLCD.locate(1, 12);
-        while(i < 15 && *line) {
-            uLCD.printf("%c", *line);
-            wait(0.05);
-            i++;
-            line++;
-        }
+void long_speech(const char *lines[], int n)
+{
+    begin(lines, n);
+}
 
-        if(!*line) {
-            speech_bubble_wait();
-            break;
+/**
+ * Type up to n more characters of the page.
+ */
+static void type(int n)
+{
+    int start = 0;  // Characters of the page before line l
+    for (int l = 0; l < SPEECH_PAGE_LINES && n > 0; l++) {
+        int line = dlg.page + l;
+        int len = dlg.len[line];
+        if (dlg.typed < start + len) {
+            int from = dlg.typed - start;
+            int to = from + n < len ? from + n : len;
+            draw_speech_line(dlg.text[line], from, to, l);
+            dlg.typed += to - from;
+            n -= to - from;
         }
+        start += len;
+    }
+}
 
-        uLCD.locate(1, 13);
-        while(i < 30 && *line) {
-            uLCD.printf("%c", *line);
-            wait(0.05);
-            i++;
-            line++;
-        }
-        speech_bubble_wait();
+int speech_update(int b1)
+{
+    int down = !b1;
+    int pressed = down && !dlg.held;
+    dlg.held = down;
+
+    if (!dlg.open) {
+        if (!down) dlg.swallow = 0;
+        return dlg.swallow;
+    }
+
+    // Still typing: a press shows the rest of the page at once
+    int total = 0;
+    for (int l = 0; l < SPEECH_PAGE_LINES; l++) {
+        total += dlg.len[dlg.page + l];
+    }
+    if (dlg.typed < total) {
+        type(pressed ? total - dlg.typed : SPEECH_CHARS_PER_TICK);
+        return 1;
     }
+
+    // Page complete: blink until a press turns the page
+    if (!pressed) {
+        if (dlg.blink % BLINK_TICKS == 0) draw_speech_prompt(dlg.blink / BLINK_TICKS % 2 == 0);
+        dlg.blink++;
+        return 1;
+    }
+
+    dlg.page += SPEECH_PAGE_LINES;
+    if (dlg.page < dlg.lines) {
+        dlg.typed = 0;
+        dlg.blink = 0;
+        draw_speech_bubble();
+    } else {
+        erase_speech_bubble();
+        dlg.swallow = 1;
+    }
+    return 1;
 }
 
-void long_speech(const char *lines[], int n)
+int speech_active()
+{
+    return dlg.open;
+}
+
+int speech_covers(int top, int height)
 {
+    return dlg.open && top <= BUBBLE_BOTTOM && top + height > BUBBLE_TOP;
 }
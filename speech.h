@@ -2,16 +2,65 @@
 #define SPEECH_H
 
 /**
- * Display a speech bubble.
+ * Speech bubbles. A bubble covers the bottom of the map view and types its
+ * text out a few characters per game tick while the game keeps running; the
+ * action button shows the rest of a page at once, turns to the next page, and
+ * after the last one closes the bubble.
+ *
+ * The text is word-wrapped when a speech starts and is not copied: it must
+ * stay valid until the bubble closes, as string literals do.
+ */
+
+/**
+ * Characters that fit on a line of the bubble, and lines per page.
+ */
+#define SPEECH_LINE_LEN 15
+#define SPEECH_PAGE_LINES 2
+
+/**
+ * Most lines queued at once. Text beyond this is dropped.
+ */
+#define SPEECH_MAX_LINES 24
+
+/**
+ * Characters typed per game tick (see timestep.h): 20 a second.
+ */
+#define SPEECH_CHARS_PER_TICK 2
+
+/**
+ * Display a speech bubble. If one is already showing, the text follows on a
+ * page of its own.
  */
 void speech(const char* line);
 
 /**
- * Display a long speech bubble (more than 2 lines).
- * 
- * @param lines The actual lines of text to display
+ * Display a long speech bubble (more than 2 lines), paged as needed.
+ *
+ * @param lines The actual lines of text to display; each starts a new line
  * @param n The number of lines to display.
  */
 void long_speech(const char* lines[], int n);
 
-#endif // SPEECH_H
\ No newline at end of file
+/**
+ * Advance the bubble by one game tick. b1 is the action button as read (0
+ * while pressed).
+ *
+ * Returns nonzero while the speech has the action button: while a bubble is
+ * up, and after it closed until the button is released, so the press that
+ * closes a bubble does not also act in the game.
+ */
+int speech_update(int b1);
+
+/**
+ * Returns nonzero if a bubble is up.
+ */
+int speech_active();
+
+/**
+ * Returns nonzero if the bubble is up and covers any of the screen rows top
+ * to top + height - 1. The map must not draw there; once the bubble closes,
+ * it is up to the map to redraw what was covered.
+ */
+int speech_covers(int top, int height);
+
+#endif // SPEECH_H
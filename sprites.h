@@ -0,0 +1,252 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+/**
+ * Sprite atlas for the 11x11 map tiles, stored in flash. Each pixel is a
+ * 4-bit index into sprite_palette, packed two to a byte with the left pixel
+ * in the high nibble. Rows are padded to 6 bytes so every hex digit below is
+ * one pixel and a sprite reads like its picture. Included by graphics.cpp only.
+ */
+#define SPRITE_W        11
+#define SPRITE_H        11
+#define SPRITE_ROW_BYTES 6
+#define SPRITE_BYTES    (SPRITE_ROW_BYTES * SPRITE_H)
+
+#define SPRITE_PLAYER       0
+#define SPRITE_PLAYER_KEY   1
+#define SPRITE_WALL         2
+#define SPRITE_PLANT        3
+#define SPRITE_WIZARD       4
+#define SPRITE_KEY          5
+#define SPRITE_SPELL        6
+#define SPRITE_SPELL_DARK   7
+#define SPRITE_CHEST        8
+#define SPRITE_LADDAR       9
+#define SPRITE_DRAGON       10
+#define SPRITE_GOBLIN       11
+#define SPRITE_GRAVE        12
+#define SPRITE_ELIXIR       13
+#define SPRITE_SIGN         14
+#define NUM_SPRITES         15
+
+/**
+ * RGB565 colors shared by all sprites.
+ */
+static const unsigned short sprite_palette[16] = {
+    0x0000, // 0: #000000
+    0x07e2, // 1: #00ff13
+    0xdfe0, // 2: #dbff00
+    0x8430, // 3: #848484
+    0xf814, // 4: #ff00a2
+    0x1b5a, // 5: #1e69d2
+    0xffff, // 6: #ffffff
+    0xfd20, // 7: #ffa600
+    0xf840, // 8: #ff0800
+    0x001f, // 9: #0000ff
+    0x079f, // A: #00f2ff
+    0x9160, // B: #962d00
+    0xf800, // C: #ff0004
+    0x07e0, // D: #04ff00
+    0x07fe, // E: #00fff6
+    0x6b4d, // F: #6b6b6b
+};
+
+static const unsigned char sprite_atlas[NUM_SPRITES][SPRITE_BYTES] = {
+    { // SPRITE_PLAYER
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+        0x11, 0x00, 0x11, 0x10, 0x01, 0x10,
+        0x11, 0x00, 0x11, 0x10, 0x01, 0x10,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+        0x10, 0x00, 0x00, 0x00, 0x00, 0x10,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+        0x11, 0x11, 0x11, 0x11, 0x11, 0x10,
+    },
+    { // SPRITE_PLAYER_KEY
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x00, 0x00, 0x02, 0x20, 0x00,
+        0x00, 0x00, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x00, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x00, 0x00, 0x02, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x00, 0x02, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+    },
+    { // SPRITE_WALL
+        0x03, 0x33, 0x33, 0x33, 0x33, 0x00,
+        0x30, 0x33, 0x33, 0x33, 0x30, 0x30,
+        0x33, 0x00, 0x00, 0x00, 0x03, 0x30,
+        0x33, 0x03, 0x33, 0x33, 0x03, 0x30,
+        0x33, 0x03, 0x33, 0x33, 0x03, 0x30,
+        0x33, 0x03, 0x33, 0x33, 0x03, 0x30,
+        0x33, 0x03, 0x33, 0x33, 0x03, 0x30,
+        0x33, 0x03, 0x33, 0x33, 0x03, 0x30,
+        0x33, 0x00, 0x00, 0x00, 0x03, 0x30,
+        0x30, 0x33, 0x33, 0x33, 0x30, 0x30,
+        0x03, 0x33, 0x33, 0x33, 0x33, 0x00,
+    },
+    { // SPRITE_PLANT
+        0x44, 0x44, 0x44, 0x44, 0x44, 0x40,
+        0x44, 0x44, 0x44, 0x44, 0x44, 0x40,
+        0x44, 0x44, 0x44, 0x44, 0x44, 0x40,
+        0x45, 0x54, 0x45, 0x44, 0x55, 0x40,
+        0x44, 0x55, 0x45, 0x45, 0x54, 0x40,
+        0x44, 0x45, 0x55, 0x55, 0x44, 0x40,
+        0x00, 0x00, 0x55, 0x50, 0x00, 0x00,
+        0x00, 0x00, 0x55, 0x50, 0x00, 0x00,
+        0x00, 0x00, 0x55, 0x50, 0x00, 0x00,
+        0x00, 0x00, 0x55, 0x50, 0x00, 0x00,
+        0x00, 0x00, 0x55, 0x50, 0x00, 0x00,
+    },
+    { // SPRITE_WIZARD
+        0x66, 0x66, 0x66, 0x66, 0x66, 0x60,
+        0x66, 0x66, 0x66, 0x66, 0x66, 0x60,
+        0x77, 0x77, 0x77, 0x77, 0x77, 0x70,
+        0x70, 0x07, 0x77, 0x77, 0x00, 0x70,
+        0x77, 0x07, 0x77, 0x77, 0x70, 0x70,
+        0x77, 0x77, 0x70, 0x77, 0x77, 0x70,
+        0x77, 0x77, 0x70, 0x77, 0x77, 0x70,
+        0x77, 0x77, 0x77, 0x77, 0x77, 0x70,
+        0x66, 0x67, 0x00, 0x07, 0x66, 0x60,
+        0x66, 0x66, 0x77, 0x76, 0x66, 0x60,
+        0x66, 0x66, 0x66, 0x66, 0x66, 0x60,
+    },
+    { // SPRITE_KEY
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x00, 0x00, 0x02, 0x20, 0x00,
+        0x00, 0x00, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x00, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x00, 0x00, 0x02, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x00, 0x02, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+        0x00, 0x22, 0x22, 0x22, 0x20, 0x00,
+    },
+    { // SPRITE_SPELL
+        0x00, 0x00, 0x02, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x22, 0x20, 0x00, 0x00,
+        0x00, 0x00, 0x28, 0x20, 0x00, 0x00,
+        0x00, 0x02, 0x28, 0x22, 0x00, 0x00,
+        0x00, 0x02, 0x88, 0x82, 0x00, 0x00,
+        0x00, 0x22, 0x88, 0x82, 0x20, 0x00,
+        0x00, 0x28, 0x88, 0x88, 0x20, 0x00,
+        0x22, 0x28, 0x88, 0x88, 0x22, 0x20,
+        0x28, 0x88, 0x88, 0x88, 0x88, 0x20,
+        0x28, 0x88, 0x88, 0x88, 0x88, 0x20,
+        0x28, 0x88, 0x88, 0x88, 0x88, 0x20,
+    },
+    { // SPRITE_SPELL_DARK
+        0x00, 0x00, 0x99, 0x90, 0x00, 0x00,
+        0x00, 0x09, 0x9A, 0x99, 0x00, 0x00,
+        0x00, 0x09, 0x9A, 0x99, 0x00, 0x00,
+        0x00, 0x99, 0xAA, 0xA9, 0x90, 0x00,
+        0x00, 0x99, 0xAA, 0xA9, 0x90, 0x00,
+        0x09, 0x9A, 0xAA, 0xAA, 0x99, 0x00,
+        0x09, 0x9A, 0xAA, 0xAA, 0x99, 0x00,
+        0x99, 0xAA, 0xAA, 0xAA, 0xA9, 0x90,
+        0x99, 0xAA, 0xAA, 0xAA, 0xA9, 0x90,
+        0x99, 0xAA, 0xAA, 0xAA, 0xA9, 0x90,
+        0x99, 0xAA, 0xAA, 0xAA, 0xA9, 0x90,
+    },
+    { // SPRITE_CHEST
+        0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xB0,
+        0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xB0,
+        0xBB, 0xBB, 0xBB, 0xBB, 0xBB, 0xB0,
+        0x77, 0x77, 0x77, 0x77, 0x77, 0x70,
+        0xBB, 0xBB, 0x77, 0xBB, 0xBB, 0xB0,
+        0xBB, 0xBB, 0xB7, 0xBB, 0xBB, 0xB0,
+        0x77, 0x77, 0x77, 0x77, 0x77, 0x70,
+        0xB7, 0xBB, 0xBB, 0xBB, 0xB7, 0xB0,
+        0xB7, 0xBB, 0xBB, 0xBB, 0xB7, 0xB0,
+        0xB7, 0xBB, 0xBB, 0xBB, 0xB7, 0xB0,
+        0xB7, 0xBB, 0xBB, 0xBB, 0xB7, 0xB0,
+    },
+    { // SPRITE_LADDAR
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x66, 0x60, 0x00, 0x00, 0x00, 0x00,
+        0xCC, 0xC0, 0x00, 0x00, 0x00, 0x00,
+        0x66, 0x66, 0x60, 0x00, 0x00, 0x00,
+        0xCC, 0xCC, 0xC0, 0x00, 0x00, 0x00,
+        0x66, 0x66, 0x66, 0x60, 0x00, 0x00,
+        0xCC, 0xCC, 0xCC, 0xC0, 0x00, 0x00,
+        0x66, 0x66, 0x66, 0x66, 0x60, 0x00,
+        0xCC, 0xCC, 0xCC, 0xCC, 0xC0, 0x00,
+        0x66, 0x66, 0x66, 0x66, 0x66, 0x60,
+    },
+    { // SPRITE_DRAGON
+        0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xD0,
+        0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xD0,
+        0xD0, 0x0D, 0xDD, 0xDD, 0x00, 0xD0,
+        0xDC, 0x0D, 0xDD, 0xDD, 0xC0, 0xD0,
+        0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xD0,
+        0xDD, 0xDD, 0x0D, 0x0D, 0xDD, 0xD0,
+        0xDD, 0xDD, 0xDD, 0xDD, 0xDD, 0xD0,
+        0xD0, 0x00, 0x00, 0x00, 0x00, 0xD0,
+        0xD0, 0x6C, 0x6C, 0x6C, 0x60, 0xD0,
+        0xD0, 0xCC, 0xCC, 0xCC, 0xC0, 0xD0,
+        0xD0, 0x00, 0x00, 0x00, 0x00, 0xD0,
+    },
+    { // SPRITE_GOBLIN
+        0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xE0,
+        0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xE0,
+        0xE0, 0x00, 0xEE, 0xE0, 0x00, 0xE0,
+        0xE0, 0x9E, 0xEE, 0xE0, 0x9E, 0xE0,
+        0xEE, 0xEE, 0xE0, 0xEE, 0xEE, 0xE0,
+        0xEE, 0xEE, 0xE9, 0xEE, 0xEE, 0xE0,
+        0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xE0,
+        0xEE, 0x00, 0x00, 0x00, 0x0E, 0xE0,
+        0xEE, 0x09, 0x99, 0x99, 0x0E, 0xE0,
+        0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xE0,
+        0xEE, 0xEE, 0xEE, 0xEE, 0xEE, 0xE0,
+    },
+    { // SPRITE_GRAVE
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0,
+        0x66, 0x66, 0xF6, 0xF6, 0x66, 0x60,
+        0x6F, 0xF6, 0xF6, 0xF6, 0xFF, 0x60,
+        0x66, 0x66, 0xF6, 0xF6, 0x66, 0x60,
+        0x66, 0xFF, 0xF6, 0xF6, 0xFF, 0xF0,
+        0x6F, 0x6F, 0xF6, 0xF6, 0xFF, 0xF0,
+        0x6F, 0xF6, 0xF6, 0xF6, 0xFF, 0xF0,
+        0x6F, 0xF6, 0xF6, 0xF6, 0xFF, 0xF0,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0,
+    },
+    { // SPRITE_ELIXIR
+        0x00, 0x66, 0x00, 0x06, 0x60, 0x00,
+        0x06, 0x88, 0x60, 0x68, 0x86, 0x00,
+        0x68, 0x88, 0x86, 0x88, 0x88, 0x60,
+        0x68, 0x88, 0x88, 0x88, 0x88, 0x60,
+        0x68, 0x88, 0x88, 0x88, 0x88, 0x60,
+        0x68, 0x88, 0x88, 0x88, 0x88, 0x60,
+        0x06, 0x88, 0x88, 0x88, 0x86, 0x00,
+        0x00, 0x68, 0x88, 0x88, 0x60, 0x00,
+        0x00, 0x06, 0x88, 0x86, 0x00, 0x00,
+        0x00, 0x00, 0x68, 0x60, 0x00, 0x00,
+        0x00, 0x00, 0x06, 0x00, 0x00, 0x00,
+    },
+    { // SPRITE_SIGN
+        0x06, 0x88, 0x88, 0x86, 0x00, 0x00,
+        0x06, 0x88, 0x88, 0x86, 0x00, 0x00,
+        0x06, 0x88, 0x88, 0x86, 0x00, 0x00,
+        0x06, 0x88, 0x88, 0x86, 0x00, 0x00,
+        0x06, 0x88, 0x88, 0x86, 0x00, 0x60,
+        0x66, 0x88, 0x88, 0x86, 0x66, 0x80,
+        0x88, 0x88, 0x88, 0x88, 0x88, 0x60,
+        0x88, 0x88, 0x88, 0x88, 0x86, 0x00,
+        0x68, 0x88, 0x88, 0x88, 0x60, 0x00,
+        0x06, 0x88, 0x88, 0x86, 0x00, 0x00,
+        0x00, 0x68, 0x88, 0x60, 0x00, 0x00,
+    },
+};
+
+#endif // SPRITES_H
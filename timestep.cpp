@@ -0,0 +1,57 @@
+#include "timestep.h"
+#include "globals.h"
+
+/**
+ * The accumulator: real time that has passed but not yet been simulated.
+ * clock measures the time since the previous timestep_frame.
+ */
+static Timer clock;
+static int accumulated_us;
+static TimestepStats stats;
+
+void timestep_start()
+{
+    clock.reset();
+    clock.start();
+    accumulated_us = 0;
+}
+
+int timestep_frame()
+{
+    int elapsed = clock.read_us();
+    clock.reset();
+    accumulated_us += elapsed;
+
+    int ticks = accumulated_us / TICK_US;
+    if (ticks > MAX_TICKS_PER_FRAME) {
+        stats.dropped_ticks += ticks - MAX_TICKS_PER_FRAME;
+        accumulated_us -= (ticks - MAX_TICKS_PER_FRAME) * TICK_US;
+        ticks = MAX_TICKS_PER_FRAME;
+    }
+    accumulated_us -= ticks * TICK_US;
+
+    if (ticks) {
+        stats.ticks += ticks;
+        stats.frames++;
+        stats.dropped_frames += ticks - 1;
+        if (ticks > 1) stats.late_frames++;
+    }
+    return ticks;
+}
+
+int timestep_idle_us()
+{
+    int left = TICK_US - accumulated_us - clock.read_us();
+    return left > 0 ? left : 0;
+}
+
+const TimestepStats* timestep_stats()
+{
+    return &stats;
+}
+
+void print_timestep_stats()
+{
+    pc.printf("timestep: %u ticks, %u frames, %u dropped frames, %u late frames, %u dropped ticks\r\n",
+              stats.ticks, stats.frames, stats.dropped_frames, stats.late_frames, stats.dropped_ticks);
+}
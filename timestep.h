@@ -0,0 +1,70 @@
+#ifndef TIMESTEP_H
+#define TIMESTEP_H
+
+/**
+ * Fixed-timestep scheduling for the game loop.
+ *
+ * The game state advances in ticks of exactly TICK_US of real time, however
+ * long drawing takes. Each pass of the main loop asks timestep_frame how many
+ * ticks are due, runs that many updates, and then draws once. When a frame
+ * takes longer than a tick, the next pass runs several ticks back to back and
+ * the frames in between are skipped, so the game keeps its speed and only
+ * the screen updates less often. After a long stall (a blocking speech
+ * bubble, the omnipotent toggle) at most MAX_TICKS_PER_FRAME ticks are
+ * caught up and the rest of the backlog is dropped, so the game pauses
+ * instead of racing to catch up.
+ */
+
+/**
+ * Simulation rate. 10 ticks a second is the pace the game always had: one
+ * step per tick.
+ */
+#define TICK_HZ 10
+#define TICK_US (1000000 / TICK_HZ)
+
+/**
+ * Most ticks run between two frames.
+ */
+#define MAX_TICKS_PER_FRAME 4
+
+/**
+ * Counters since timestep_start.
+ */
+typedef struct {
+    unsigned int ticks;             // Updates run
+    unsigned int frames;            // Frames drawn (passes that ran a tick)
+    unsigned int dropped_frames;    // Ticks that were not followed by a frame
+    unsigned int late_frames;       // Frames that had to catch up more than one tick
+    unsigned int dropped_ticks;     // Ticks given up after a stall
+} TimestepStats;
+
+/**
+ * Start (or restart) the clock with no ticks due, e.g. when the game screen
+ * appears after the menu.
+ */
+void timestep_start();
+
+/**
+ * Account for the time since the last call and return how many ticks to run
+ * now (0 to MAX_TICKS_PER_FRAME). The caller runs them and then draws one
+ * frame if the result was nonzero.
+ */
+int timestep_frame();
+
+/**
+ * Microseconds until the next tick is due, for idling when timestep_frame
+ * returns 0.
+ */
+int timestep_idle_us();
+
+/**
+ * The counters.
+ */
+const TimestepStats* timestep_stats();
+
+/**
+ * Print the counters to the serial console.
+ */
+void print_timestep_stats();
+
+#endif // TIMESTEP_H
@@ -0,0 +1,167 @@
+/*
+ * mapc: the map compiler.
+ *
+ * Turns an ASCII map layout into a compiled .map file (see map_format.h) that
+ * map_load() reads in one pass. This is a host tool; build it with
+ *
+ *      g++ -I.. -o mapc mapc.cpp
+ *
+ * and run it as
+ *
+ *      mapc dungeon.txt dungeon.map
+ *
+ * then copy the output to /maps/ on the SD card.
+ *
+ * Layout file: one line per map row, one character per cell, using the legend
+ * in map_format.h. Short lines are padded with empty space. After the layout,
+ * lines starting with '@' add entity payloads:
+ *
+ *      @stairs x y tm tx ty    the ladder at (x,y) leads to (tx,ty) on map tm
+ *
+ * Lines starting with '#' are comments.
+ */
+#include "map.h"
+#include "map_format.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SIZE 1024
+
+struct Stairs {
+    int x, y, tm, tx, ty;
+};
+
+static char cells[MAX_SIZE * MAX_SIZE];
+static Stairs stairs[256];
+static int num_stairs;
+
+static void put_u16(FILE* out, unsigned int v)
+{
+    fputc(v & 0xFF, out);
+    fputc((v >> 8) & 0xFF, out);
+}
+
+static void put_u32(FILE* out, unsigned long v)
+{
+    put_u16(out, v & 0xFFFF);
+    put_u16(out, (v >> 16) & 0xFFFF);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s layout.txt out.map\n", argv[0]);
+        return 1;
+    }
+    FILE* in = fopen(argv[1], "r");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    // Read the layout and the directives
+    char line[MAX_SIZE + 64];
+    int w = 0, h = 0;
+    memset(cells, ' ', sizeof(cells));
+    while (fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#') continue;
+        if (line[0] == '@') {
+            Stairs* s = &stairs[num_stairs];
+            if (num_stairs < 256 && sscanf(line, "@stairs %d %d %d %d %d", &s->x, &s->y, &s->tm, &s->tx, &s->ty) == 5) {
+                num_stairs++;
+            } else {
+                fprintf(stderr, "%s: bad directive: %s\n", argv[1], line);
+                return 1;
+            }
+            continue;
+        }
+        int len = strlen(line);
+        if (len > MAX_SIZE || h >= MAX_SIZE) {
+            fprintf(stderr, "%s: map larger than %dx%d\n", argv[1], MAX_SIZE, MAX_SIZE);
+            return 1;
+        }
+        for (int x = 0; x < len; x++) {
+            if (map_legend_kind(line[x]) < 0) {
+                fprintf(stderr, "%s:%d: unknown symbol '%c'\n", argv[1], h + 1, line[x]);
+                return 1;
+            }
+            cells[h * MAX_SIZE + x] = line[x];
+        }
+        if (len > w) w = len;
+        h++;
+    }
+    fclose(in);
+
+    // Tile layer: run length encode the kinds, and count what goes in the header
+    unsigned char* rle = (unsigned char*) malloc(2 * w * h + 2);
+    long rle_bytes = 0;
+    int occupied = 0, entities = 0;
+    int run_kind = -1, run_len = 0;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            char symbol = cells[y * MAX_SIZE + x];
+            int kind = map_legend_kind(symbol);
+            if (kind != TILE_NONE) occupied++;
+            if (map_legend_is_entity(symbol)) entities++;
+            if (kind != run_kind || run_len == 255) {
+                if (run_len) {
+                    rle[rle_bytes++] = run_len;
+                    rle[rle_bytes++] = run_kind;
+                }
+                run_kind = kind;
+                run_len = 0;
+            }
+            run_len++;
+        }
+    }
+    if (run_len) {
+        rle[rle_bytes++] = run_len;
+        rle[rle_bytes++] = run_kind;
+    }
+
+    FILE* out = fopen(argv[2], "wb");
+    if (!out) {
+        perror(argv[2]);
+        return 1;
+    }
+    fwrite(MAP_MAGIC, 1, 4, out);
+    put_u16(out, MAP_VERSION);
+    put_u16(out, w);
+    put_u16(out, h);
+    put_u32(out, occupied);
+    put_u32(out, entities);
+    put_u32(out, rle_bytes);
+    fwrite(rle, 1, rle_bytes, out);
+
+    // Entity list, in row-major order
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            char symbol = cells[y * MAX_SIZE + x];
+            if (!map_legend_is_entity(symbol)) continue;
+            fputc(symbol, out);
+            put_u16(out, x);
+            put_u16(out, y);
+
+            Stairs* s = NULL;
+            for (int i = 0; i < num_stairs; i++) {
+                if (stairs[i].x == x && stairs[i].y == y) s = &stairs[i];
+            }
+            if (s && map_legend_kind(symbol) == TILE_LADDAR) {
+                fputc(MAP_STAIRS_PAYLOAD, out);
+                put_u16(out, s->tm);
+                put_u16(out, s->tx);
+                put_u16(out, s->ty);
+            } else {
+                fputc(0, out);
+            }
+        }
+    }
+    fclose(out);
+    free(rle);
+
+    printf("%s: %dx%d, %d tiles, %d entities, %ld tile bytes\n", argv[2], w, h, occupied, entities, rle_bytes);
+    return 0;
+}
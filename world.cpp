@@ -0,0 +1,278 @@
+#include "world.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORLD_HEADER_SIZE 16
+#define CHUNK_BYTES (CHUNK_SIZE * CHUNK_SIZE)
+
+/**
+ * One slot of the chunk cache.
+ */
+typedef struct {
+    int cx, cy;         // Chunk coordinates, or -1 if the slot is unused
+    int dirty;          // Modified since it was loaded
+    unsigned int used;  // Value of the world's clock at the last access
+    unsigned char tiles[CHUNK_BYTES];
+} Chunk;
+
+struct World {
+    FILE* file;                 // Read-only unless opened with world_edit
+    int writable;
+    FILE* scratch;              // Modified chunks evicted from the cache, or NULL
+    char scratch_path[64];
+    int* saved;                 // Chunk index of each chunk in the scratch file
+    int saved_count, saved_size;
+    int w, h;                   // Size in tiles
+    int chunks_w, chunks_h;     // Size in chunks
+    unsigned int clock;         // Bumped on every chunk access, for LRU
+    Chunk* last;                // Most recently used chunk (fast path)
+    Chunk cache[WORLD_CACHE_CHUNKS];
+};
+
+/**
+ * Build the file name of a world into path.
+ */
+static void world_path(char* path, int size, const char* name)
+{
+    snprintf(path, size, "%s/worlds/%s.wld", WORLD_ROOT, name);
+}
+
+static void put_u16(unsigned char* p, unsigned int v) { p[0] = v; p[1] = v >> 8; }
+static void put_u32(unsigned char* p, unsigned int v) { put_u16(p, v); put_u16(p + 2, v >> 16); }
+static unsigned int get_u16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+static unsigned int get_u32(const unsigned char* p) { return get_u16(p) | (get_u16(p + 2) << 16); }
+
+/**
+ * Byte offset of chunk (cx,cy) in the file.
+ */
+static long chunk_offset(World* world, int cx, int cy)
+{
+    return WORLD_HEADER_SIZE + (long)(cy * world->chunks_w + cx) * CHUNK_BYTES;
+}
+
+/**
+ * Returns where chunk (cx,cy) is in the scratch file, in chunks, or -1 if it
+ * is not there. If add is nonzero a missing chunk gets the next place, and -1
+ * means the scratch file could not be made or grown.
+ */
+static int scratch_slot(World* world, int cx, int cy, int add)
+{
+    int index = cy * world->chunks_w + cx;
+    for (int i = 0; i < world->saved_count; i++) {
+        if (world->saved[i] == index) return i;
+    }
+    if (!add) return -1;
+
+    if (!world->scratch) {
+        world->scratch = fopen(world->scratch_path, "w+b");
+        if (!world->scratch) return -1;
+    }
+    if (world->saved_count == world->saved_size) {
+        int size = world->saved_size ? 2 * world->saved_size : 8;
+        int* saved = (int*) realloc(world->saved, size * sizeof(int));
+        if (!saved) return -1;
+        world->saved = saved;
+        world->saved_size = size;
+    }
+    world->saved[world->saved_count] = index;
+    return world->saved_count++;
+}
+
+/**
+ * Write a modified chunk out: back to the world file if it was opened with
+ * world_edit, otherwise to the scratch file.
+ */
+static void chunk_write_back(World* world, Chunk* chunk)
+{
+    if (!chunk->dirty) return;
+    chunk->dirty = 0;
+    if (world->writable) {
+        fseek(world->file, chunk_offset(world, chunk->cx, chunk->cy), SEEK_SET);
+        fwrite(chunk->tiles, 1, CHUNK_BYTES, world->file);
+        return;
+    }
+    int slot = scratch_slot(world, chunk->cx, chunk->cy, 1);
+    if (slot < 0) return;   // No room on the card: the change is lost
+    fseek(world->scratch, (long) slot * CHUNK_BYTES, SEEK_SET);
+    fwrite(chunk->tiles, 1, CHUNK_BYTES, world->scratch);
+}
+
+/**
+ * Returns the cached chunk (cx,cy), loading it into the least recently used
+ * slot if it is not in the cache.
+ */
+static Chunk* chunk_get(World* world, int cx, int cy)
+{
+    Chunk* chunk = world->last;
+    if (chunk && chunk->cx == cx && chunk->cy == cy) return chunk;
+
+    Chunk* victim = &world->cache[0];
+    for (int i = 0; i < WORLD_CACHE_CHUNKS; i++) {
+        chunk = &world->cache[i];
+        if (chunk->cx == cx && chunk->cy == cy) {
+            chunk->used = ++world->clock;
+            world->last = chunk;
+            return chunk;
+        }
+        if (chunk->cx < 0 || (victim->cx >= 0 && chunk->used < victim->used)) victim = chunk;
+    }
+
+    // Miss: evict the victim and read the chunk from the card, from the
+    // scratch file if it was changed before
+    chunk_write_back(world, victim);
+    int slot = world->writable ? -1 : scratch_slot(world, cx, cy, 0);
+    FILE* file = slot < 0 ? world->file : world->scratch;
+    fseek(file, slot < 0 ? chunk_offset(world, cx, cy) : (long) slot * CHUNK_BYTES, SEEK_SET);
+    if (fread(victim->tiles, 1, CHUNK_BYTES, file) != CHUNK_BYTES) {
+        memset(victim->tiles, 0, CHUNK_BYTES); // Short file: treat as empty
+    }
+    victim->cx = cx;
+    victim->cy = cy;
+    victim->dirty = 0;
+    victim->used = ++world->clock;
+    world->last = victim;
+    return victim;
+}
+
+/**
+ * Open a world for play (writable zero) or for writing back to its file.
+ */
+static World* open_world(const char* name, int writable)
+{
+    char path[64];
+    unsigned char header[WORLD_HEADER_SIZE];
+    world_path(path, sizeof(path), name);
+
+    FILE* file = fopen(path, writable ? "r+b" : "rb");
+    if (!file) return NULL;
+    if (fread(header, 1, WORLD_HEADER_SIZE, file) != WORLD_HEADER_SIZE
+        || memcmp(header, "WRLD", 4) != 0
+        || get_u16(header + 4) != WORLD_VERSION
+        || get_u16(header + 6) != CHUNK_SIZE) {
+        fclose(file);
+        return NULL;
+    }
+
+    World* world = (World*) malloc(sizeof(World));
+    if (!world) {
+        fclose(file);
+        return NULL;
+    }
+    world->file = file;
+    world->writable = writable;
+    world->scratch = NULL;
+    snprintf(world->scratch_path, sizeof(world->scratch_path), "%s/worlds/%s.tmp", WORLD_ROOT, name);
+    world->saved = NULL;
+    world->saved_count = world->saved_size = 0;
+    world->w = get_u32(header + 8);
+    world->h = get_u32(header + 12);
+    world->chunks_w = (world->w + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    world->chunks_h = (world->h + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    world->clock = 0;
+    world->last = NULL;
+    for (int i = 0; i < WORLD_CACHE_CHUNKS; i++) {
+        world->cache[i].cx = world->cache[i].cy = -1;
+        world->cache[i].dirty = 0;
+        world->cache[i].used = 0;
+    }
+    return world;
+}
+
+World* world_open(const char* name)
+{
+    return open_world(name, 0);
+}
+
+World* world_edit(const char* name)
+{
+    return open_world(name, 1);
+}
+
+void world_close(World* world)
+{
+    if (world->writable) world_flush(world);
+    fclose(world->file);
+    if (world->scratch) {
+        fclose(world->scratch);
+        remove(world->scratch_path);
+    }
+    free(world->saved);
+    free(world);
+}
+
+int world_create(const char* name, int w, int h)
+{
+    char path[64];
+    unsigned char header[WORLD_HEADER_SIZE];
+    unsigned char empty[CHUNK_BYTES];
+    world_path(path, sizeof(path), name);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return 0;
+
+    memcpy(header, "WRLD", 4);
+    put_u16(header + 4, WORLD_VERSION);
+    put_u16(header + 6, CHUNK_SIZE);
+    put_u32(header + 8, w);
+    put_u32(header + 12, h);
+    int ok = fwrite(header, 1, WORLD_HEADER_SIZE, file) == WORLD_HEADER_SIZE;
+
+    memset(empty, 0, CHUNK_BYTES);
+    int chunks = ((w + CHUNK_SIZE - 1) / CHUNK_SIZE) * ((h + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    for (int i = 0; i < chunks && ok; i++) {
+        ok = fwrite(empty, 1, CHUNK_BYTES, file) == CHUNK_BYTES;
+    }
+    fclose(file);
+    return ok;
+}
+
+int world_width(World* world)
+{
+    return world->w;
+}
+
+int world_height(World* world)
+{
+    return world->h;
+}
+
+int world_get(World* world, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= world->w || y >= world->h) return -1;
+    Chunk* chunk = chunk_get(world, x / CHUNK_SIZE, y / CHUNK_SIZE);
+    return chunk->tiles[(y % CHUNK_SIZE) * CHUNK_SIZE + (x % CHUNK_SIZE)];
+}
+
+void world_set(World* world, int x, int y, unsigned char tile)
+{
+    if (x < 0 || y < 0 || x >= world->w || y >= world->h) return;
+    Chunk* chunk = chunk_get(world, x / CHUNK_SIZE, y / CHUNK_SIZE);
+    chunk->tiles[(y % CHUNK_SIZE) * CHUNK_SIZE + (x % CHUNK_SIZE)] = tile;
+    chunk->dirty = 1;
+}
+
+void world_prefetch(World* world, int x0, int y0, int x1, int y1)
+{
+    // Clamp to the world, then touch every chunk in the rectangle. Touching
+    // makes them the most recently used, so far away chunks go first.
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 >= world->w) x1 = world->w - 1;
+    if (y1 >= world->h) y1 = world->h - 1;
+    for (int cy = y0 / CHUNK_SIZE; cy <= y1 / CHUNK_SIZE && y0 <= y1; cy++) {
+        for (int cx = x0 / CHUNK_SIZE; cx <= x1 / CHUNK_SIZE && x0 <= x1; cx++) {
+            chunk_get(world, cx, cy);
+        }
+    }
+}
+
+void world_flush(World* world)
+{
+    for (int i = 0; i < WORLD_CACHE_CHUNKS; i++) {
+        if (world->cache[i].cx >= 0) chunk_write_back(world, &world->cache[i]);
+    }
+    if (world->writable) fflush(world->file);
+    else if (world->scratch) fflush(world->scratch);
+}
@@ -0,0 +1,104 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+/**
+ * Chunked world files.
+ *
+ * A world is a rectangle of one-byte tiles stored on the SD card, cut into
+ * CHUNK_SIZE x CHUNK_SIZE chunks. Only a small, fixed number of chunks
+ * (WORLD_CACHE_CHUNKS) is held in RAM at a time; reading a tile pages its
+ * chunk in, evicting the least recently used one (written back first if it
+ * was modified). This keeps RAM use bounded no matter how big the world is.
+ *
+ * A world opened for play never changes its file: modified chunks are
+ * written back to a scratch file beside it, WORLD_ROOT/worlds/<name>.tmp,
+ * which is deleted when the world is closed, so every session starts from
+ * the world as shipped. Worlds are written with world_edit.
+ *
+ * File layout (all integers little endian):
+ *      "WRLD"              magic
+ *      u16 version         WORLD_VERSION
+ *      u16 chunk size      CHUNK_SIZE
+ *      u32 width, height   in tiles
+ *      chunks              row-major, CHUNK_SIZE*CHUNK_SIZE bytes each,
+ *                          tiles row-major inside a chunk
+ *
+ * Tiles past the right/bottom edge of the world in the last chunk column/row
+ * are stored but never read.
+ */
+
+#define CHUNK_SIZE 16
+#define WORLD_CACHE_CHUNKS 12
+#define WORLD_VERSION 1
+
+/**
+ * Where world files live. SDFileSystem mounts the card at "/sd"; a host build
+ * can point this at a plain directory instead.
+ */
+#ifndef WORLD_ROOT
+#define WORLD_ROOT "/sd"
+#endif
+
+/**
+ * A world that is open for streaming. The implementation is private.
+ */
+struct World;
+
+/**
+ * Open WORLD_ROOT/worlds/<name>.wld for play: changes last until the world is
+ * closed. Returns NULL if the file is missing or not a valid world file.
+ */
+World* world_open(const char* name);
+
+/**
+ * Open WORLD_ROOT/worlds/<name>.wld to change it: modified chunks are written
+ * back to the file itself.
+ */
+World* world_edit(const char* name);
+
+/**
+ * Close the world and free it. A world opened with world_edit writes back its
+ * modified chunks first; one opened with world_open drops its changes.
+ */
+void world_close(World* world);
+
+/**
+ * Create WORLD_ROOT/worlds/<name>.wld as an empty (all zero) w x h world.
+ * Returns nonzero on success.
+ */
+int world_create(const char* name, int w, int h);
+
+/**
+ * The size of the world in tiles.
+ */
+int world_width(World* world);
+int world_height(World* world);
+
+/**
+ * Returns the tile at (x,y), paging its chunk in if needed, or -1 if (x,y) is
+ * outside the world.
+ */
+int world_get(World* world, int x, int y);
+
+/**
+ * Sets the tile at (x,y). The chunk is written back to the card when it is
+ * evicted or the world is flushed. Does nothing outside the world. If the
+ * card is full, a change to a world opened with world_open is lost when its
+ * chunk is evicted.
+ */
+void world_set(World* world, int x, int y, unsigned char tile);
+
+/**
+ * Page in every chunk touching the rectangle (x0,y0)-(x1,y1), so drawing and
+ * moving around it do not hit the card. Call this with the viewport (plus a
+ * margin) whenever the player moves; chunks far away are evicted first.
+ */
+void world_prefetch(World* world, int x0, int y0, int x1, int y1);
+
+/**
+ * Write every modified chunk back to the card (to the scratch file for a
+ * world opened with world_open).
+ */
+void world_flush(World* world);
+
+#endif // WORLD_H